@@ -0,0 +1,388 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <stdexcept>
+
+// Signed integer of any size, as a sign and a magnitude in base 2^32 limbs, least significant first.
+// Only what GetPiDigitsChudnovsky and PiSpigot need: comparison, addition, subtraction, Karatsuba multiplication, long division, square root and decimal output.
+// Division, square root and decimal output are quadratic, so they only pay off on the final result, not inside the splitting.
+class BigInteger
+{
+public:
+	BigInteger() = default;
+
+	BigInteger(const int64_t value) : negative(value < 0)
+	{
+		uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+		while (magnitude != 0)
+		{
+			limbs.push_back((uint32_t)magnitude);
+			magnitude >>= 32;
+		}
+	}
+
+	bool IsZero() const { return limbs.empty(); }
+	bool IsNegative() const { return negative; }
+
+	// The value, for one that fits in 63 bits.
+	int64_t ToInt64() const
+	{
+		uint64_t magnitude = 0;
+		for (size_t i = std::min<size_t>(limbs.size(), 2); i-- > 0;)
+		{
+			magnitude = magnitude << 32 | limbs[i];
+		}
+		return negative ? -(int64_t)magnitude : (int64_t)magnitude;
+	}
+
+	// 10^exponent, by squaring.
+	static BigInteger PowerOfTen(size_t exponent)
+	{
+		BigInteger result = 1, power = 10;
+		for (; exponent != 0; exponent >>= 1)
+		{
+			if (exponent & 1) result = result * power;
+			if (exponent > 1) power = power * power;
+		}
+		return result;
+	}
+
+	// Largest r with r * r <= x, for x >= 0.
+	static BigInteger SquareRoot(const BigInteger& x)
+	{
+		if (x.negative) throw std::runtime_error(std::string("Square root of a negative BigInteger."));
+		return BigInteger(SquareRootMagnitude(x.limbs), false);
+	}
+
+	// Decimal digits, with a leading '-' if negative. Takes 9 digits at a time off the bottom.
+	std::string ToString() const
+	{
+		if (IsZero()) return "0";
+
+		std::string digits;
+		Limbs rest = limbs;
+		while (!rest.empty())
+		{
+			uint32_t chunk = DivideSmall(rest, 1000000000u);
+			for (int i = 0; i < 9 && (!rest.empty() || chunk != 0); i++)
+			{
+				digits += (char)('0' + chunk % 10);
+				chunk /= 10;
+			}
+		}
+		if (negative) digits += '-';
+		std::reverse(digits.begin(), digits.end());
+		return digits;
+	}
+
+	friend bool operator<(const BigInteger& a, const BigInteger& b)
+	{
+		if (a.negative != b.negative) return a.negative;
+		const int comparison = CompareMagnitudes(a.limbs, b.limbs);
+		return a.negative ? comparison > 0 : comparison < 0;
+	}
+
+	friend BigInteger operator+(const BigInteger& a, const BigInteger& b)
+	{
+		if (a.negative == b.negative) return BigInteger(AddMagnitudes(a.limbs, b.limbs), a.negative);
+		if (CompareMagnitudes(a.limbs, b.limbs) >= 0) return BigInteger(SubtractMagnitudes(a.limbs, b.limbs), a.negative);
+		return BigInteger(SubtractMagnitudes(b.limbs, a.limbs), b.negative);
+	}
+
+	friend BigInteger operator-(const BigInteger& a, const BigInteger& b)
+	{
+		BigInteger negated = b;
+		negated.negative = !b.negative && !b.IsZero();
+		return a + negated;
+	}
+
+	friend BigInteger operator*(const BigInteger& a, const BigInteger& b)
+	{
+		return BigInteger(MultiplyMagnitudes(a.limbs, b.limbs), a.negative != b.negative);
+	}
+
+	// Rounded toward zero, like the built-in integers.
+	friend BigInteger operator/(const BigInteger& a, const BigInteger& b)
+	{
+		if (b.IsZero()) throw std::runtime_error(std::string("BigInteger division by zero."));
+		return BigInteger(DivideMagnitudes(a.limbs, b.limbs), a.negative != b.negative);
+	}
+
+private:
+	using Limbs = std::vector<uint32_t>;
+
+	static constexpr const size_t KARATSUBA_THRESHOLD = 32; // Limbs below which schoolbook multiplication is faster than splitting further.
+
+	Limbs limbs; // Magnitude, least significant limb first, without leading zero limbs. Empty for 0.
+	bool negative = false; // Never set for 0.
+
+	BigInteger(Limbs magnitude, const bool isNegative) : limbs(std::move(magnitude))
+	{
+		Trim(limbs);
+		negative = isNegative && !limbs.empty();
+	}
+
+	static void Trim(Limbs& x)
+	{
+		while (!x.empty() && x.back() == 0) x.pop_back();
+	}
+
+	static int CompareMagnitudes(const Limbs& a, const Limbs& b)
+	{
+		if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+		for (size_t i = a.size(); i-- > 0;)
+		{
+			if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+		}
+		return 0;
+	}
+
+	static Limbs AddMagnitudes(const Limbs& a, const Limbs& b)
+	{
+		const Limbs& longer = a.size() >= b.size() ? a : b;
+		const Limbs& shorter = a.size() >= b.size() ? b : a;
+		Limbs sum(longer.size() + 1);
+		uint64_t carry = 0;
+		for (size_t i = 0; i < longer.size(); i++)
+		{
+			carry += (uint64_t)longer[i] + (i < shorter.size() ? shorter[i] : 0);
+			sum[i] = (uint32_t)carry;
+			carry >>= 32;
+		}
+		sum.back() = (uint32_t)carry;
+		Trim(sum);
+		return sum;
+	}
+
+	// a - b, for a >= b.
+	static Limbs SubtractMagnitudes(const Limbs& a, const Limbs& b)
+	{
+		Limbs difference(a.size());
+		int64_t borrow = 0;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			const int64_t t = (int64_t)a[i] - (i < b.size() ? b[i] : 0) - borrow;
+			difference[i] = (uint32_t)t;
+			borrow = t < 0;
+		}
+		Trim(difference);
+		return difference;
+	}
+
+	// Adds x * 2^(32 * shift) into sum, which must be large enough to hold the result.
+	static void AddShifted(Limbs& sum, const Limbs& x, const size_t shift)
+	{
+		uint64_t carry = 0;
+		size_t i = 0;
+		for (; i < x.size(); i++)
+		{
+			carry += (uint64_t)sum[i + shift] + x[i];
+			sum[i + shift] = (uint32_t)carry;
+			carry >>= 32;
+		}
+		for (; carry != 0; i++)
+		{
+			carry += sum[i + shift];
+			sum[i + shift] = (uint32_t)carry;
+			carry >>= 32;
+		}
+	}
+
+	static Limbs MultiplySchoolbook(const Limbs& a, const Limbs& b)
+	{
+		Limbs product(a.size() + b.size());
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			uint64_t carry = 0;
+			for (size_t j = 0; j < b.size(); j++)
+			{
+				carry += (uint64_t)a[i] * b[j] + product[i + j];
+				product[i + j] = (uint32_t)carry;
+				carry >>= 32;
+			}
+			product[i + b.size()] = (uint32_t)carry;
+		}
+		Trim(product);
+		return product;
+	}
+
+	// Karatsuba: a = a1 * B + a0 and b = b1 * B + b0 take three half-size products instead of four, with a1 * b0 + a0 * b1 = (a0 + a1)(b0 + b1) - a0 * b0 - a1 * b1.
+	static Limbs MultiplyMagnitudes(const Limbs& a, const Limbs& b)
+	{
+		if (a.empty() || b.empty()) return {};
+		if (std::min(a.size(), b.size()) < KARATSUBA_THRESHOLD) return MultiplySchoolbook(a, b);
+
+		const size_t half = std::max(a.size(), b.size()) / 2;
+		const auto low = [half](const Limbs& x) { Limbs part(x.begin(), x.begin() + std::min(half, x.size())); Trim(part); return part; };
+		const auto high = [half](const Limbs& x) { return x.size() > half ? Limbs(x.begin() + half, x.end()) : Limbs(); };
+		const Limbs a0 = low(a), a1 = high(a), b0 = low(b), b1 = high(b);
+
+		Limbs product(a.size() + b.size() + 1);
+		if (b1.empty() || a1.empty()) // Unbalanced: one of them fits in the low half, two products are enough.
+		{
+			const Limbs& split = b1.empty() ? a : b;
+			const Limbs& whole = b1.empty() ? b : a;
+			AddShifted(product, MultiplyMagnitudes(low(split), whole), 0);
+			AddShifted(product, MultiplyMagnitudes(high(split), whole), half);
+		}
+		else
+		{
+			const Limbs z0 = MultiplyMagnitudes(a0, b0);
+			const Limbs z2 = MultiplyMagnitudes(a1, b1);
+			const Limbs z1 = SubtractMagnitudes(SubtractMagnitudes(MultiplyMagnitudes(AddMagnitudes(a0, a1), AddMagnitudes(b0, b1)), z0), z2);
+			AddShifted(product, z0, 0);
+			AddShifted(product, z1, half);
+			AddShifted(product, z2, 2 * half);
+		}
+		Trim(product);
+		return product;
+	}
+
+	// Divides x by d in place and returns the remainder.
+	static uint32_t DivideSmall(Limbs& x, const uint32_t d)
+	{
+		uint64_t remainder = 0;
+		for (size_t i = x.size(); i-- > 0;)
+		{
+			remainder = remainder << 32 | x[i];
+			x[i] = (uint32_t)(remainder / d);
+			remainder %= d;
+		}
+		Trim(x);
+		return (uint32_t)remainder;
+	}
+
+	static Limbs ShiftLeft(const Limbs& x, const size_t bits)
+	{
+		if (x.empty()) return {};
+		const size_t limbShift = bits / 32;
+		const int bitShift = (int)(bits % 32);
+		Limbs shifted(x.size() + limbShift + 1);
+		for (size_t i = 0; i < x.size(); i++)
+		{
+			const uint64_t wide = (uint64_t)x[i] << bitShift;
+			shifted[i + limbShift] |= (uint32_t)wide;
+			shifted[i + limbShift + 1] = (uint32_t)(wide >> 32);
+		}
+		Trim(shifted);
+		return shifted;
+	}
+
+	static Limbs ShiftRight(const Limbs& x, const size_t bits)
+	{
+		const size_t limbShift = bits / 32;
+		const int bitShift = (int)(bits % 32);
+		if (limbShift >= x.size()) return {};
+		Limbs shifted(x.size() - limbShift);
+		for (size_t i = 0; i < shifted.size(); i++)
+		{
+			const uint64_t wide = (uint64_t)x[i + limbShift] | (i + limbShift + 1 < x.size() ? (uint64_t)x[i + limbShift + 1] << 32 : 0);
+			shifted[i] = (uint32_t)(wide >> bitShift);
+		}
+		Trim(shifted);
+		return shifted;
+	}
+
+	// Floor of the square root of x. The root of x / 4^k with k a quarter of x's bits, recursively, is already right to half the bits of the
+	// root of x once scaled back by 2^k. Newton's iteration from just above it then only takes a step or two, so the whole costs about two full-size divisions.
+	static Limbs SquareRootMagnitude(const Limbs& x)
+	{
+		if (x.size() <= 2)
+		{
+			const uint64_t value = x.empty() ? 0 : x.size() == 1 ? x[0] : (uint64_t)x[1] << 32 | x[0];
+			uint64_t root = (uint64_t)std::sqrt((double)value);
+			while (root != 0 && root > value / root) root--;
+			while (root + 1 <= value / (root + 1)) root++;
+			return BigInteger((int64_t)root).limbs;
+		}
+
+		const size_t bits = 32 * x.size() - std::countl_zero(x.back());
+		const size_t k = bits / 4;
+		Limbs root = ShiftLeft(SquareRootMagnitude(ShiftRight(x, 2 * k)), k); // At most the root of x, and nonzero since x has more than 2k bits.
+		root = ShiftRight(AddMagnitudes(root, DivideMagnitudes(x, root)), 1); // At least the floor of the root of x, as any (r + x / r) / 2 is.
+		while (true)
+		{
+			Limbs next = ShiftRight(AddMagnitudes(root, DivideMagnitudes(x, root)), 1);
+			if (CompareMagnitudes(next, root) >= 0) return root;
+			root = std::move(next);
+		}
+	}
+
+	// Quotient of u / v, for v != 0. Knuth's algorithm D, as written in Hacker's Delight's divmnu: one estimated quotient limb per step from the top two limbs of the divisor, normalized so the estimate is off by at most 2.
+	static Limbs DivideMagnitudes(const Limbs& u, const Limbs& v)
+	{
+		if (CompareMagnitudes(u, v) < 0) return {};
+		if (v.size() == 1)
+		{
+			Limbs q = u;
+			DivideSmall(q, v[0]);
+			return q;
+		}
+
+		const size_t n = v.size();
+		const size_t m = u.size() - n;
+		const int s = std::countl_zero(v.back());
+
+		Limbs vn(n), un(u.size() + 1);
+		for (size_t i = n - 1; i > 0; i--)
+		{
+			vn[i] = v[i] << s | (s ? (uint32_t)((uint64_t)v[i - 1] >> (32 - s)) : 0);
+		}
+		vn[0] = v[0] << s;
+		un[u.size()] = s ? (uint32_t)((uint64_t)u.back() >> (32 - s)) : 0;
+		for (size_t i = u.size() - 1; i > 0; i--)
+		{
+			un[i] = u[i] << s | (s ? (uint32_t)((uint64_t)u[i - 1] >> (32 - s)) : 0);
+		}
+		un[0] = u[0] << s;
+
+		constexpr const uint64_t base = (uint64_t)1 << 32;
+		Limbs q(m + 1);
+		for (size_t j = m + 1; j-- > 0;)
+		{
+			const uint64_t top = (uint64_t)un[j + n] << 32 | un[j + n - 1];
+			uint64_t qhat = top / vn[n - 1];
+			uint64_t rhat = top % vn[n - 1];
+			while (qhat >= base || qhat * vn[n - 2] > (rhat << 32 | un[j + n - 2]))
+			{
+				qhat--;
+				rhat += vn[n - 1];
+				if (rhat >= base) break;
+			}
+
+			// un[j .. j + n] -= qhat * vn.
+			int64_t k = 0, t;
+			for (size_t i = 0; i < n; i++)
+			{
+				const uint64_t p = qhat * vn[i];
+				t = (int64_t)un[i + j] - k - (int64_t)(p & 0xFFFFFFFF);
+				un[i + j] = (uint32_t)t;
+				k = (int64_t)(p >> 32) - (t >> 32);
+			}
+			t = (int64_t)un[j + n] - k;
+			un[j + n] = (uint32_t)t;
+
+			q[j] = (uint32_t)qhat;
+			if (t < 0) // qhat was one too many: add vn back.
+			{
+				q[j]--;
+				uint64_t carry = 0;
+				for (size_t i = 0; i < n; i++)
+				{
+					carry += (uint64_t)un[i + j] + vn[i];
+					un[i + j] = (uint32_t)carry;
+					carry >>= 32;
+				}
+				un[j + n] += (uint32_t)carry;
+			}
+		}
+		Trim(q);
+		return q;
+	}
+};
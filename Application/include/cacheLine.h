@@ -0,0 +1,5 @@
+#pragma once
+
+#include <cstddef>
+
+constexpr const size_t CACHE_LINE_SIZE = 64; // Size of a cache line on the x86 and ARM CPUs we run on. Used to keep data written by different threads on different cache lines.
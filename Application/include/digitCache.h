@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "cacheLine.h"
+
+// The 9 digits GetNthPiDigit gives from a position on, remembered for the positions asked for lately so that overlapping requests only compute each once.
+// Each entry is the position and its digits packed into one 64-bit atomic, so a lookup is a single load that can't see half of an entry:
+// no locks, and a bounded SHARD_COUNT * SLOTS_PER_SHARD entries. Direct-mapped like PrimePowersCache: a position evicts whichever one was in its slot.
+class PiDigitCache
+{
+public:
+	// Whether pos is cached, and if so its digits. Never locks nor writes.
+	bool Find(const int pos, int& digits) const
+	{
+		const uint64_t entry = Slot(pos).load(std::memory_order_acquire);
+		if (entry >> 32 != (uint64_t)pos + 1) return false;
+
+		digits = (int)(uint32_t)entry;
+		return true;
+	}
+
+	// Remembers the digits of pos, in place of what its slot held.
+	void Store(const int pos, const int digits)
+	{
+		Slot(pos).store(((uint64_t)pos + 1) << 32 | (uint32_t)digits, std::memory_order_release);
+	}
+
+	// Forgets every position. Safe alongside Find and Store, which then see the slots either before or after they were emptied.
+	void Clear()
+	{
+		for (Shard& shard : shards)
+			for (std::atomic<uint64_t>& slot : shard.slots)
+				slot.store(0, std::memory_order_release);
+	}
+
+	// The digits of pos, from the cache or from compute(pos). Two threads missing on the same position both compute it, like PrimePowersCache's builds.
+	template<typename Compute>
+	int GetOrCompute(const int pos, const Compute& compute)
+	{
+		int digits;
+		if (Find(pos, digits)) return digits;
+
+		digits = compute(pos);
+		Store(pos, digits);
+		return digits;
+	}
+
+private:
+	static constexpr const size_t SHARD_COUNT = 16;
+	static constexpr const size_t SLOTS_PER_SHARD = 1024;
+
+	// Consecutive positions go to consecutive shards, each on cache lines of its own, so producers storing neighbouring positions don't write to the same line.
+	struct alignas(CACHE_LINE_SIZE) Shard
+	{
+		std::array<std::atomic<uint64_t>, SLOTS_PER_SHARD> slots = {}; // Position + 1 in the high half, 0 for an empty slot, and its digits in the low half.
+	};
+
+	std::atomic<uint64_t>& Slot(const int pos) { return shards[(size_t)pos % SHARD_COUNT].slots[(size_t)pos / SHARD_COUNT % SLOTS_PER_SHARD]; }
+	const std::atomic<uint64_t>& Slot(const int pos) const { return shards[(size_t)pos % SHARD_COUNT].slots[(size_t)pos / SHARD_COUNT % SLOTS_PER_SHARD]; }
+
+	std::array<Shard, SHARD_COUNT> shards;
+};
+
+// The cache the producers look digits up in.
+inline PiDigitCache& SharedPiDigitCache()
+{
+	static PiDigitCache cache;
+	return cache;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Estimated amount of work GetNthPiDigit(pos) does, in iterations of its innermost loop.
+// It runs k from 1 to N = (pos + 20) * log(10) / log(13.5) for every prime up to 3N, and there are about x / (log(x) - 1) primes up to x.
+// Only meant for comparing positions with each other: measured time per unit stays within a small factor over the positions we use.
+inline double EstimateNthPiDigitCost(const size_t pos)
+{
+	if (pos == 0) return 0.0; // Answered without computing anything.
+
+	const double N = std::floor((pos + 20) * std::log(10.0) / std::log(13.5));
+	const double primesUpTo3N = 3.0 * N / (std::log(3.0 * N) - 1.0);
+	return N * primesUpTo3N;
+}
+
+// Orders positions from most to least expensive to compute. Handing out the longest jobs first keeps a worker from
+// picking up a long one just as the others run out of work, which is what minimizes the time the whole batch takes.
+inline void SortLongestJobFirst(std::vector<size_t>& positions)
+{
+	std::stable_sort(positions.begin(), positions.end(), [](const size_t lhs, const size_t rhs)
+	{
+		return EstimateNthPiDigitCost(lhs) > EstimateNthPiDigitCost(rhs);
+	});
+}
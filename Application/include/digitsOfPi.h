@@ -25,6 +25,18 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "primeSieve.h" // Primes for the outer loop of GetNthPiDigit, sieved once and shared instead of trial-divided on every call.
+#include "primePowers.h" // The primes with their exponents and powers, per series length, computed once and shared.
 
  /* uncomment the following line to use 'long long' integers */
  /* #define HAS_LONG_LONG */
@@ -169,84 +181,973 @@ int next_prime(int n)
   }						\
 }
 
-int GetNthPiDigit(const int pos)
+/*
+ * The k loop below does all its multiplications modulo the same prime power av. Modulus types tell it how:
+ *  - Mul(x, y) multiplies a residue x by y, where y is either a residue or one of the loop's small factors (below 2^32),
+ *  - Lift(x) turns a residue into the value to pass to Mul so that it multiplies by exactly x,
+ *  - Finish(s) turns the accumulated sum back into a plain residue.
+ */
+
+/* multiplication with a hardware division, what mul_mod does */
+struct DivisionModulus
 {
-	if (pos < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
-	if (pos == 0) return 3;
+	int m;
 
-	int av, a, vmax, N, n = pos, num, den, k, kq1, kq2, kq3, kq4, t, v, s, i, t1;
-	double sum;
+	explicit DivisionModulus(int av) : m(av) {}
 
-	N = (int)((n + 20) * log(10) / log(13.5));
-	sum = 0;
+	inline int Mul(int x, int y) const { return (int)mul_mod(x, y, m); }
+	inline int Lift(int x) const { return x; }
+	inline int Finish(int s) const { return s; }
+};
 
-	for (a = 2; a <= (3 * N); a = next_prime(a)) {
-		vmax = (int)(log(3 * N) / log(a));
-		if (a == 2) {
-			vmax = vmax + (N - n);
-			if (vmax <= 0)
-				continue;
-		}
-		av = 1;
-		for (i = 0; i < vmax; i++)
-			av = av * a;
-
-		s = 0;
-		den = 1;
-		kq1 = 0;
-		kq2 = -1;
-		kq3 = -3;
-		kq4 = -2;
-		if (a == 2) {
-			num = 1;
-			v = -n;
-		}
-		else {
-			num = pow_mod(2, n, av);
-			v = 0;
-		}
+/*
+ * Montgomery multiplication with R = 2^32, for odd av: Mul(x, y) returns x * y / R mod av and needs no division.
+ * num and den pick up the same power of 1/R as they get multiplied by the same number of factors, so it cancels out
+ * in num / den. Every term then carries exactly 1/R^2 (one Mul by the inverse and one by 25k-3), which Finish
+ * multiplies back out, so the sum ends up as the very same residue DivisionModulus computes.
+ */
+struct MontgomeryModulus
+{
+	uint32_t m;
+	uint32_t mInverse; /* m^-1 mod 2^32 */
+	uint32_t r3; /* R^3 mod m */
+
+	MontgomeryModulus() : m(1), mInverse(1), r3(0) {}
+	explicit MontgomeryModulus(int av) : m((uint32_t)av)
+	{
+		mInverse = m; /* correct to 3 bits since m * m = 1 mod 8, each Newton step doubles that */
+		for (int i = 0; i < 4; i++)
+			mInverse *= 2 - m * mInverse;
+		const uint64_t r = ((uint64_t)1 << 32) % m;
+		r3 = (uint32_t)(r * r % m * r % m);
+	}
+
+	/* x * y / R mod m, for x < m and y < 2^32 so that x * y < m * R */
+	inline int Mul(uint32_t x, uint32_t y) const
+	{
+		const uint64_t p = (uint64_t)x * y;
+		const uint32_t q = (uint32_t)p * mInverse; /* q * m = p mod R, so p - q * m is a multiple of R */
+		const int64_t r = (int64_t)(p >> 32) - (int64_t)(((uint64_t)q * m) >> 32);
+		return (int)(r < 0 ? r + m : r);
+	}
+	inline int Lift(int x) const { return (int)(((uint64_t)x << 32) % m); }
+	inline int Finish(int s) const { return Mul(s, r3); }
+};
+
+/* high 64 bits of the 128 bit product of a and b */
+inline uint64_t mul_high(uint64_t a, uint64_t b)
+{
+#ifdef _MSC_VER
+	return __umulh(a, b);
+#else
+	return (uint64_t)(((unsigned __int128)a * b) >> 64);
+#endif
+}
+
+/* number of trailing zero bits of x, for x != 0 */
+inline int ctz(uint32_t x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return (int)index;
+#else
+	return __builtin_ctz(x);
+#endif
+}
+
+inline int ctz(uint64_t x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (int)index;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
+/*
+ * return the inverse of x mod m, for odd m and 0 < x < m coprime with it. Same result as inv_mod2, computed differently:
+ * Kaliski's almost inverse, a binary GCD of m and x that keeps m = u s + v r and x s = +-v 2^k, x r = -+u 2^k mod m.
+ * Each step subtracts the smaller of u and v from the larger and strips every factor of two of the difference at once
+ * with ctz. The larger one is moved into u with a masked swap rather than a branch, which flips the signs, tracked in
+ * swapped. It ends at u = v = 1 with x^-1 = +-s 2^-k, and the 2^-k is taken out Montgomery style, up to 31 bits at a time.
+ */
+inline uint32_t inv_mod_binary(uint32_t x, uint32_t m)
+{
+	uint32_t u, v, r, s, mask, swapped, t, mInverse, q;
+	uint64_t y;
+	int k, tz, j;
+
+	k = ctz(x);
+	u = m;
+	v = x >> k;
+	r = 0;
+	s = 1;
+	swapped = 0;
+	while (u != v) {
+		mask = (uint32_t)0 - (uint32_t)(u < v);
+		t = (u ^ v) & mask;
+		u ^= t;
+		v ^= t;
+		t = (r ^ s) & mask;
+		r ^= t;
+		s ^= t;
+		swapped ^= mask;
+
+		u -= v;
+		r += s;
+		tz = ctz(u);
+		u >>= tz;
+		s <<= tz;
+		k += tz;
+	}
+
+	mInverse = m; /* m^-1 mod 2^32, see MontgomeryModulus */
+	for (int i = 0; i < 4; i++)
+		mInverse *= 2 - m * mInverse;
+	y = swapped ? m - s : s;
+	while (k > 0) {
+		j = k < 31 ? k : 31;
+		q = ((uint32_t)0 - (uint32_t)y * mInverse) & (((uint32_t)1 << j) - 1); /* y + q m is a multiple of 2^j */
+		y = (y + (uint64_t)q * m) >> j;
+		k -= j;
+	}
+	return (uint32_t)(y >= m ? y - m : y);
+}
+
+/* same for 64 bit words, for odd m < 2^63 */
+inline uint64_t inv_mod_binary(uint64_t x, uint64_t m)
+{
+	uint64_t u, v, r, s, mask, swapped, t, mInverse, q, y, low, high;
+	int k, tz, j;
+
+	k = ctz(x);
+	u = m;
+	v = x >> k;
+	r = 0;
+	s = 1;
+	swapped = 0;
+	while (u != v) {
+		mask = (uint64_t)0 - (uint64_t)(u < v);
+		t = (u ^ v) & mask;
+		u ^= t;
+		v ^= t;
+		t = (r ^ s) & mask;
+		r ^= t;
+		s ^= t;
+		swapped ^= mask;
+
+		u -= v;
+		r += s;
+		tz = ctz(u);
+		u >>= tz;
+		s <<= tz;
+		k += tz;
+	}
+
+	mInverse = m;
+	for (int i = 0; i < 5; i++)
+		mInverse *= 2 - m * mInverse;
+	y = swapped ? m - s : s;
+	while (k > 0) {
+		j = k < 63 ? k : 63;
+		q = ((uint64_t)0 - y * mInverse) & (((uint64_t)1 << j) - 1);
+		low = q * m;
+		high = mul_high(q, m);
+		low += y;
+		high += low < y; /* carry */
+		y = (low >> j) | (high << (64 - j));
+		k -= j;
+	}
+	return y >= m ? y - m : y;
+}
+
+/*
+ * Barrett reduction: with mu = floor(2^64 / m) computed once, p / m is mul_high(p, mu) or one less,
+ * so x * y mod m takes two multiplications and at most one subtraction instead of a division.
+ * Works for any av, including powers of two.
+ */
+struct BarrettModulus
+{
+	uint64_t m;
+	uint64_t mu; /* floor(2^64 / m) */
+
+	explicit BarrettModulus(int av) : m((uint64_t)av), mu(~(uint64_t)0 / (uint64_t)av) {} /* (2^64 - 1) / m only differs from 2^64 / m when m is a power of two, where being one short is still covered by the correction below */
+
+	/* x * y mod m, for x < m and y < 2^32 */
+	inline int Mul(uint64_t x, uint64_t y) const
+	{
+		const uint64_t p = x * y;
+		uint64_t r = p - mul_high(p, mu) * m;
+		if (r >= m)
+			r -= m;
+		return (int)r;
+	}
+	inline int Lift(int x) const { return x; }
+	inline int Finish(int s) const { return s; }
+};
 
-		for (k = 1; k <= N; k++) {
+/* how PrimeContribution divides the terms of its sum by den */
+enum class Inversion
+{
+	PerTerm, /* Bellard's: a modular inverse of den for every term */
+	Once, /* the sum kept as a fraction s / den, multiplied by the same factors as den: a single inverse at the end */
+};
 
+/*
+ * which prime PrimeContribution is instantiated for. 2 gets a loop of its own: its factors come out of 2k, 3(3k - 1)
+ * and 3k - 2 with ctz, 2k - 1 never has any, and av is a power of two. The loop for odd primes is then left without
+ * a single test of a == 2.
+ */
+struct PrimeTwo {};
+struct OddPrime {};
+
+/* return the contribution of the prime a to the n'th digit: the numerator over av of its fraction */
+template<typename Prime, typename Modulus, Inversion inversion = Inversion::Once>
+int PrimeContribution(int n, int N, int a, int vmax, int av)
+{
+	constexpr bool two = std::is_same<Prime, PrimeTwo>::value;
+	int num, den, k, kq1, kq2, kq3, kq4, t, v, s, i, t1, tz;
+	const Modulus mod(av);
+	const int aLifted = mod.Lift(a % av);
+
+	s = 0;
+	den = 1;
+	kq1 = 0;
+	kq2 = -1;
+	kq3 = -3;
+	kq4 = -2;
+	if (two) {
+		num = 1;
+		v = -n;
+	}
+	else {
+		num = pow_mod(2, n, av);
+		v = 0;
+	}
+
+	for (k = 1; k <= N; k++) {
+
+		if constexpr (two) {
+			tz = ctz((uint32_t)k);
+			t = k >> tz; /* 2k without its factors of two */
+			v -= tz + 1;
+			num = mod.Mul(num, t);
+
+			t = 2 * k - 1;
+			num = mod.Mul(num, t);
+
+			t = 3 * (3 * k - 1);
+			tz = ctz((uint32_t)t);
+			t >>= tz;
+			v += tz;
+			den = mod.Mul(den, t);
+			if (inversion == Inversion::Once)
+				s = mod.Mul(s, t);
+
+			t = (3 * k - 2);
+			tz = ctz((uint32_t)t);
+			t >>= tz;
+			v += tz + 1; /* the 2 the odd primes multiply den by */
+			den = mod.Mul(den, t);
+			if (inversion == Inversion::Once)
+				s = mod.Mul(s, t);
+		}
+		else {
 			t = 2 * k;
 			DIVN(t, a, v, -1, kq1, 2);
-			num = mul_mod(num, t, av);
+			num = mod.Mul(num, t);
 
 			t = 2 * k - 1;
 			DIVN(t, a, v, -1, kq2, 2);
-			num = mul_mod(num, t, av);
+			num = mod.Mul(num, t);
 
 			t = 3 * (3 * k - 1);
 			DIVN(t, a, v, 1, kq3, 9);
-			den = mul_mod(den, t, av);
+			den = mod.Mul(den, t);
+			if (inversion == Inversion::Once)
+				s = mod.Mul(s, t);
 
 			t = (3 * k - 2);
 			DIVN(t, a, v, 1, kq4, 3);
-			if (a != 2)
-				t = t * 2;
+			t = t * 2;
+			den = mod.Mul(den, t);
+			if (inversion == Inversion::Once)
+				s = mod.Mul(s, t);
+		}
+
+		if (v > 0) {
+			if (inversion == Inversion::Once)
+				t = num; /* over den like s, so no inverse needed to add it */
+			else if (two)
+				t = mod.Mul(inv_mod(den, av), num);
 			else
-				v++;
-			den = mul_mod(den, t, av);
+				t = mod.Mul((int)inv_mod_binary((uint32_t)den, (uint32_t)av), num);
+			for (i = v; i < vmax; i++)
+				t = mod.Mul(t, aLifted);
+			t1 = (25 * k - 3);
+			t = mod.Mul(t, t1);
+			s += t;
+			if (s >= av)
+				s -= av;
+		}
+	}
+
+	if (inversion == Inversion::Once) {
+		/* s / den, which carries 1/R^2 per term like the per term sum: each term has one Mul less than there, and this one adds it back */
+		if (two)
+			s = mod.Mul(s, inv_mod(den, av));
+		else
+			s = mod.Mul(s, (int)inv_mod_binary((uint32_t)den, (uint32_t)av));
+	}
+
+	s = mod.Finish(s);
+	t = pow_mod(5, n - 1, av);
+	s = mul_mod(s, t, av);
+	return s;
+}
+
+/*
+ * Vector kernels: one odd prime per lane, all lanes stepping through k together.
+ *
+ * They handle the primes above sqrt(3N), which are nearly all of them. For those av = a and vmax = 1, and the loop's
+ * factors 2k, 2k - 1, 3(3k - 1), 2(3k - 2) and 25k - 3 are the same in every lane. The lanes only part ways at the
+ * k where a divides one of the factors, which happens once every a / 4 iterations at most: the kernel runs the
+ * plain vector step up to the next such k and does that one iteration lane by lane.
+ *
+ * Lanes can't each stop for a modular inverse of den on every term, so the sum is kept as a fraction P / den instead:
+ * P gets multiplied by the same factors as den and each term adds num (25k - 3), leaving a single inverse at the end.
+ * Multiplication is MontgomeryModulus's, on 64 bit lanes. Every lane ends up with the exact residue
+ * PrimeContribution computes, so results don't depend on which kernel ran.
+ */
+
+enum class SimdLevel
+{
+	None, /* scalar PrimeContribution only */
+	Avx2, /* 4 primes at once */
+	Avx512, /* 8 primes at once */
+};
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DIGITS_OF_PI_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/* best instruction set both the CPU and the OS support, checked once */
+inline SimdLevel DetectSimdLevel()
+{
+	static const SimdLevel level = [] {
+#if defined(DIGITS_OF_PI_X86) && defined(_MSC_VER)
+		int regs[4];
+		__cpuid(regs, 0);
+		if (regs[0] < 7)
+			return SimdLevel::None;
+		__cpuid(regs, 1);
+		const bool osSavesYmm = (regs[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+		const bool osSavesZmm = osSavesYmm && (_xgetbv(0) & 0xe6) == 0xe6;
+		__cpuidex(regs, 7, 0);
+		if (osSavesZmm && (regs[1] & (1 << 16)))
+			return SimdLevel::Avx512;
+		if (osSavesYmm && (regs[1] & (1 << 5)))
+			return SimdLevel::Avx2;
+		return SimdLevel::None;
+#elif defined(DIGITS_OF_PI_X86)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return SimdLevel::Avx512;
+		if (__builtin_cpu_supports("avx2"))
+			return SimdLevel::Avx2;
+		return SimdLevel::None;
+#else
+		return SimdLevel::None;
+#endif
+	}();
+	return level;
+}
+
+/* whether the vector kernels can take the prime a */
+inline bool FitsSimdLane(int a, int vmax, int N)
+{
+	return vmax == 1 && a > 9 && (uint64_t)25 * N < ((uint64_t)1 << 32); /* a > 9: no factor steps over two multiples of a. 25N: largest factor must fit Montgomery's 32 bits */
+}
+
+/* first k after k where a divides one of the loop's factors, given the residues of k for which it does */
+inline int NextDivisibleK(int k, int a, const int* residues)
+{
+	int next = k + a;
+	for (int i = 0; i < 4; i++) {
+		int d = (residues[i] - k % a + a) % a;
+		if (d == 0)
+			d = a;
+		if (k + d < next)
+			next = k + d;
+	}
+	return next;
+}
+
+/* one iteration of the fraction form of the loop for a single prime with vmax = 1 */
+inline void SimdLaneStep(int k, int a, const MontgomeryModulus& mod, uint64_t& num, uint64_t& den, uint64_t& P, int64_t& v)
+{
+	int t;
+
+	t = 2 * k;
+	while (t % a == 0) { t /= a; v--; }
+	num = mod.Mul((uint32_t)num, t);
+
+	t = 2 * k - 1;
+	while (t % a == 0) { t /= a; v--; }
+	num = mod.Mul((uint32_t)num, t);
+
+	t = 3 * (3 * k - 1);
+	while (t % a == 0) { t /= a; v++; }
+	den = mod.Mul((uint32_t)den, t);
+	P = mod.Mul((uint32_t)P, t);
+
+	t = 3 * k - 2;
+	while (t % a == 0) { t /= a; v++; }
+	t = t * 2;
+	den = mod.Mul((uint32_t)den, t);
+	P = mod.Mul((uint32_t)P, t);
+
+	if (v > 0) {
+		P += mod.Mul((uint32_t)num, 25 * k - 3);
+		if (P >= mod.m)
+			P -= mod.m;
+	}
+}
+
+#if defined(__GNUC__)
+#define SIMD_INLINE __attribute__((always_inline)) inline
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_INLINE __forceinline
+#define SIMD_TARGET(isa)
+#endif
+
+#ifdef DIGITS_OF_PI_X86
+
+struct Avx2Lanes
+{
+	static constexpr int COUNT = 4;
+	using Vector = __m256i;
+	using Mask = __m256i;
+
+	SIMD_TARGET("avx2") static inline Vector Load(const uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+	SIMD_TARGET("avx2") static inline void Store(uint64_t* p, Vector x) { _mm256_storeu_si256((__m256i*)p, x); }
+	SIMD_TARGET("avx2") static inline Vector Broadcast(uint64_t x) { return _mm256_set1_epi64x((long long)x); }
+	SIMD_TARGET("avx2") static inline Mask Positive(const int64_t* v) { return _mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i*)v), _mm256_setzero_si256()); }
+
+	/* Montgomery x * y / 2^32 mod m, lane by lane */
+	SIMD_TARGET("avx2") static inline Vector Mul(Vector x, Vector y, Vector m, Vector mInverse)
+	{
+		const __m256i p = _mm256_mul_epu32(x, y);
+		const __m256i q = _mm256_mul_epu32(p, mInverse);
+		const __m256i qm = _mm256_mul_epu32(q, m);
+		const __m256i r = _mm256_sub_epi64(_mm256_srli_epi64(p, 32), _mm256_srli_epi64(qm, 32));
+		return _mm256_add_epi64(r, _mm256_and_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), r), m));
+	}
+
+	/* s + t mod m in the lanes where mask is set, s elsewhere */
+	SIMD_TARGET("avx2") static inline Vector AddWhere(Mask mask, Vector s, Vector t, Vector m)
+	{
+		const __m256i sum = _mm256_add_epi64(s, _mm256_and_si256(t, mask));
+		return _mm256_sub_epi64(sum, _mm256_andnot_si256(_mm256_cmpgt_epi64(m, sum), m));
+	}
+};
+
+struct Avx512Lanes
+{
+	static constexpr int COUNT = 8;
+	using Vector = __m512i;
+	using Mask = __mmask8;
+
+	SIMD_TARGET("avx512f") static inline Vector Load(const uint64_t* p) { return _mm512_loadu_si512(p); }
+	SIMD_TARGET("avx512f") static inline void Store(uint64_t* p, Vector x) { _mm512_storeu_si512(p, x); }
+	SIMD_TARGET("avx512f") static inline Vector Broadcast(uint64_t x) { return _mm512_set1_epi64((long long)x); }
+	SIMD_TARGET("avx512f") static inline Mask Positive(const int64_t* v) { return _mm512_cmpgt_epi64_mask(_mm512_loadu_si512(v), _mm512_setzero_si512()); }
+
+	SIMD_TARGET("avx512f") static inline Vector Mul(Vector x, Vector y, Vector m, Vector mInverse)
+	{
+		const __m512i p = _mm512_mul_epu32(x, y);
+		const __m512i q = _mm512_mul_epu32(p, mInverse);
+		const __m512i qm = _mm512_mul_epu32(q, m);
+		const __m512i r = _mm512_sub_epi64(_mm512_srli_epi64(p, 32), _mm512_srli_epi64(qm, 32));
+		return _mm512_mask_add_epi64(r, _mm512_cmplt_epi64_mask(r, _mm512_setzero_si512()), r, m);
+	}
+
+	SIMD_TARGET("avx512f") static inline Vector AddWhere(Mask mask, Vector s, Vector t, Vector m)
+	{
+		const __m512i sum = _mm512_mask_add_epi64(s, mask, s, t);
+		return _mm512_mask_sub_epi64(sum, _mm512_cmpge_epu64_mask(sum, m), sum, m);
+	}
+};
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi" /* always inlined into a function compiled for Lanes' instruction set, so vectors never cross an ABI boundary */
+#endif
+
+/* contributions s[i] of primes[i], for Lanes::COUNT primes that all FitsSimdLane */
+template<typename Lanes>
+SIMD_INLINE void PrimeContributionsSimd(int n, int N, const int* primes, int* s)
+{
+	constexpr int W = Lanes::COUNT;
+	uint64_t m[W], mInverse[W], num[W], den[W], P[W];
+	int64_t v[W];
+	int residues[W][4], nextK[W];
+	MontgomeryModulus mods[W];
 
-			if (v > 0) {
-				if (a != 2)
-					t = inv_mod2(den, av);
+	int kEvent = N + 1;
+	for (int lane = 0; lane < W; lane++) {
+		const int a = primes[lane];
+		mods[lane] = MontgomeryModulus(a);
+		m[lane] = mods[lane].m;
+		mInverse[lane] = mods[lane].mInverse;
+		num[lane] = pow_mod(2, n, a);
+		den[lane] = 1;
+		P[lane] = 0;
+		v[lane] = 0;
+		residues[lane][0] = 0; /* a divides 2k */
+		residues[lane][1] = (a + 1) / 2; /* a divides 2k - 1 */
+		residues[lane][2] = (a % 3 == 1) ? (2 * a + 1) / 3 : (a + 1) / 3; /* a divides 3k - 1: k is the inverse of 3 */
+		residues[lane][3] = 2 * residues[lane][2] % a; /* a divides 3k - 2 */
+		nextK[lane] = NextDivisibleK(0, a, residues[lane]);
+		if (nextK[lane] < kEvent)
+			kEvent = nextK[lane];
+	}
+
+	const typename Lanes::Vector vm = Lanes::Load(m), vmInverse = Lanes::Load(mInverse);
+	typename Lanes::Vector vnum = Lanes::Load(num), vden = Lanes::Load(den), vP = Lanes::Load(P);
+	typename Lanes::Mask addTerm = Lanes::Positive(v);
+
+	int k = 1;
+	while (k <= N) {
+		const int kStop = kEvent <= N ? kEvent : N + 1;
+		for (; k < kStop; k++) {
+			const uint64_t k64 = (uint64_t)k;
+			vnum = Lanes::Mul(vnum, Lanes::Broadcast(2 * k64), vm, vmInverse);
+			vnum = Lanes::Mul(vnum, Lanes::Broadcast(2 * k64 - 1), vm, vmInverse);
+			const typename Lanes::Vector f3 = Lanes::Broadcast(9 * k64 - 3), f4 = Lanes::Broadcast(6 * k64 - 4);
+			vden = Lanes::Mul(Lanes::Mul(vden, f3, vm, vmInverse), f4, vm, vmInverse);
+			vP = Lanes::Mul(Lanes::Mul(vP, f3, vm, vmInverse), f4, vm, vmInverse);
+			const typename Lanes::Vector term = Lanes::Mul(vnum, Lanes::Broadcast(25 * k64 - 3), vm, vmInverse);
+			vP = Lanes::AddWhere(addTerm, vP, term, vm);
+		}
+		if (k > N)
+			break;
+
+		/* some prime divides a factor at this k: do this iteration lane by lane */
+		Lanes::Store(num, vnum);
+		Lanes::Store(den, vden);
+		Lanes::Store(P, vP);
+		kEvent = N + 1;
+		for (int lane = 0; lane < W; lane++) {
+			SimdLaneStep(k, primes[lane], mods[lane], num[lane], den[lane], P[lane], v[lane]);
+			if (nextK[lane] == k)
+				nextK[lane] = NextDivisibleK(k, primes[lane], residues[lane]);
+			if (nextK[lane] < kEvent)
+				kEvent = nextK[lane];
+		}
+		vnum = Lanes::Load(num);
+		vden = Lanes::Load(den);
+		vP = Lanes::Load(P);
+		addTerm = Lanes::Positive(v);
+		k++;
+	}
+
+	Lanes::Store(den, vden);
+	Lanes::Store(P, vP);
+	for (int lane = 0; lane < W; lane++) {
+		const MontgomeryModulus& mod = mods[lane];
+		int t = mod.Mul((uint32_t)P[lane], (int)inv_mod_binary((uint32_t)den[lane], (uint32_t)primes[lane])); /* P / den carries 1/R^2 like PrimeContribution's sum */
+		t = mod.Finish(t);
+		s[lane] = (int)mul_mod(t, pow_mod(5, n - 1, primes[lane]), primes[lane]);
+	}
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+SIMD_TARGET("avx2") inline void PrimeContributionsAvx2(int n, int N, const int* primes, int* s)
+{
+	PrimeContributionsSimd<Avx2Lanes>(n, N, primes, s);
+}
+
+SIMD_TARGET("avx512f") inline void PrimeContributionsAvx512(int n, int N, const int* primes, int* s)
+{
+	PrimeContributionsSimd<Avx512Lanes>(n, N, primes, s);
+}
+
+#endif//!DIGITS_OF_PI_X86
+
+/* number of terms of the series needed for the n'th digit, carried far enough for extraDigits more digits than usual to be right */
+inline int SeriesLength(int n, int extraDigits = 0)
+{
+	return (int)((n + 20 + extraDigits) * log(10) / log(13.5));
+}
+
+/*
+ * Contribution s[p] / avs[p] of each of the count primes to the n'th digit, where N = SeriesLength(n), given the primes'
+ * exponents and powers from the PrimePowers of N. Uses the given modular multiplication for the odd primes the vector kernels
+ * don't take, and the given vector kernel. Primes contribute independently of each other, so any split of a digit's primes into ranges gives the same results.
+ */
+template<typename OddModulus, Inversion inversion = Inversion::Once>
+void PrimeContributions(int n, int N, const uint32_t* primes, const int* vmaxes, const int* powers, size_t count, SimdLevel simd, int* s, int* avs)
+{
+	int av, a, vmax, i;
+
+	int lanes = 0;
+#ifdef DIGITS_OF_PI_X86
+	if (simd == SimdLevel::Avx512)
+		lanes = Avx512Lanes::COUNT;
+	else if (simd == SimdLevel::Avx2)
+		lanes = Avx2Lanes::COUNT;
+#endif
+	int group[8], groupS[8]; /* primes waiting for a vector kernel and their contributions */
+	int grouped = 0;
+
+	for (size_t p = 0; p < count; p++) {
+		a = (int)primes[p];
+		vmax = vmaxes[p];
+
+		if (lanes != 0 && FitsSimdLane(a, vmax, N)) {
+			group[grouped++] = a;
+			if (grouped == lanes || p + 1 == count) {
+				for (i = grouped; i < lanes; i++)
+					group[i] = group[0]; /* pad with a prime we already have, its extra results are ignored */
+#ifdef DIGITS_OF_PI_X86
+				if (simd == SimdLevel::Avx512)
+					PrimeContributionsAvx512(n, N, group, groupS);
 				else
-					t = inv_mod(den, av);
-				t = mul_mod(t, num, av);
-				for (i = v; i < vmax; i++)
-					t = mul_mod(t, a, av);
-				t1 = (25 * k - 3);
-				t = mul_mod(t, t1, av);
-				s += t;
-				if (s >= av)
-					s -= av;
+					PrimeContributionsAvx2(n, N, group, groupS);
+#endif
+				for (i = 0; i < grouped; i++) {
+					s[p + 1 - grouped + i] = groupS[i];
+					avs[p + 1 - grouped + i] = group[i];
+				}
+				grouped = 0;
 			}
+			continue;
+		}
+
+		if (a == 2) {
+			vmax = vmax + (N - n);
+			if (vmax <= 0) {
+				s[p] = 0; /* contributes nothing */
+				avs[p] = 1;
+				continue;
+			}
+			av = 1 << vmax;
+		}
+		else
+			av = powers[p];
+
+		if (a == 2)
+			s[p] = PrimeContribution<PrimeTwo, DivisionModulus, inversion>(n, N, a, vmax, av); /* av is a power of two, Montgomery needs it odd */
+		else
+			s[p] = PrimeContribution<OddPrime, OddModulus, inversion>(n, N, a, vmax, av);
+		avs[p] = av;
+	}
+}
+
+/* fractional part of the sum of the contributions, always added in prime order so that the same double comes out however they were computed */
+inline double SumContributions(const int* s, const int* avs, size_t count)
+{
+	double sum = 0;
+	for (size_t p = 0; p < count; p++)
+		sum = fmod(sum + (double)s[p] / (double)avs[p], 1.0);
+	return sum;
+}
+
+/* s / av as a 0.64 fixed-point fraction, rounded down. s < av < 2^31, so two steps of long division by av are exact in 64 bits */
+inline uint64_t FixedPointFraction(int s, int av)
+{
+	const uint64_t high = ((uint64_t)s << 32) / (uint64_t)av;
+	const uint64_t remainder = ((uint64_t)s << 32) % (uint64_t)av;
+	return (high << 32) | ((remainder << 32) / (uint64_t)av);
+}
+
+/*
+ * fractional part of the sum of the contributions in 0.64 fixed point. Additions wrap around at 1 and are exact,
+ * so the only error is the rounding down of each fraction: the result is at most count units of 2^-64 below the exact sum.
+ */
+inline uint64_t SumContributionsFixedPoint(const int* s, const int* avs, size_t count)
+{
+	uint64_t sum = 0;
+	for (size_t p = 0; p < count; p++)
+		sum += FixedPointFraction(s[p], avs[p]);
+	return sum;
+}
+
+/*
+ * bound on the terms of the series past N for the n'th digit. Those terms are about 102.5 k^1.5 (2/27)^k times 10^n:
+ * twice their sum is below 250 (N+1)^1.5 10^n 13.5^-(N+1), which is below 250 (N+1)^1.5 10^-(20+extraDigits) for N = SeriesLength(n, extraDigits).
+ */
+inline double SeriesTailBound(int64_t n, int64_t N)
+{
+	return exp(log(250.0) + 1.5 * log(N + 1.0) + n * log(10.0) - (N + 1) * log(13.5));
+}
+
+/*
+ * bound on how far SumContributions can be from the exact fractional part: two roundings per prime (the division and
+ * the addition, each within 2^-53 since both results are below 2), plus the terms of the series past N.
+ */
+inline double ContributionsErrorBound(size_t count, int n, int N)
+{
+	return (double)count * 2 * ldexp(1.0, -53) + SeriesTailBound(n, N);
+}
+
+/* same for SumContributionsFixedPoint, in units of 2^-64 */
+inline uint64_t FixedPointErrorBound(size_t count, int64_t n, int64_t N)
+{
+	return (uint64_t)count + (uint64_t)ceil(ldexp(SeriesTailBound(n, N), 64));
+}
+
+/* fractional part of the sum for the pos'th digit, whose leading decimals are the digits of pi from position pos on. Sets *error to a bound on how far off it is */
+template<typename OddModulus, Inversion inversion = Inversion::Once>
+double PiFractionWith(const int pos, const SimdLevel simd, double* error = nullptr)
+{
+	const int N = SeriesLength(pos);
+	const PrimePowersCache::Snapshot table = SharedPrimePowers().For(N);
+	const size_t count = table->primes.size();
+
+	std::vector<int> s(count), avs(count);
+	PrimeContributions<OddModulus, inversion>(pos, N, table->primes.data(), table->vmax.data(), table->av.data(), count, simd, s.data(), avs.data());
+	if (error)
+		*error = ContributionsErrorBound(count, pos, N);
+	return SumContributions(s.data(), avs.data(), count);
+}
+
+/*
+ * PiFractionWith summed in 0.64 fixed point instead, with the series carried extraDigits further so that its tail
+ * doesn't undo the extra precision. Sets *error to a bound in units of 2^-64: the exact fraction is within that of the result, modulo 1.
+ */
+template<typename OddModulus>
+uint64_t PiFixedPointFractionWith(const int pos, const SimdLevel simd, const int extraDigits, uint64_t* error = nullptr)
+{
+	const int N = SeriesLength(pos, extraDigits);
+	const PrimePowersCache::Snapshot table = SharedPrimePowers().For(N);
+	const size_t count = table->primes.size();
+
+	std::vector<int> s(count), avs(count);
+	PrimeContributions<OddModulus>(pos, N, table->primes.data(), table->vmax.data(), table->av.data(), count, simd, s.data(), avs.data());
+	if (error)
+		*error = FixedPointErrorBound(count, pos, N);
+	return SumContributionsFixedPoint(s.data(), avs.data(), count);
+}
+
+/* GetNthPiDigit with the given modular multiplication and inversion for the primes the vector kernels don't take, and the given vector kernel */
+template<typename OddModulus, Inversion inversion = Inversion::Once>
+int GetNthPiDigitWith(const int pos, const SimdLevel simd = DetectSimdLevel())
+{
+	if (pos < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
+	if (pos == 0) return 3;
+
+	return (int)(PiFractionWith<OddModulus, inversion>(pos, simd) * 1e9);
+}
+
+int GetNthPiDigit(const int pos)
+{
+	return GetNthPiDigitWith<MontgomeryModulus>(pos);
+}
+
+/* how GetPiDigitBlock adds up the contributions of the primes */
+enum class Accumulator {
+	Double, /* fmod in a double like GetNthPiDigit: about 2^-52 of error per prime, which leaves 9 to 12 digits */
+	FixedPoint, /* 0.64 fixed point: under 2^-64 of error per prime, which leaves 13 to 15 digits */
+};
+
+/* most digits one call of the kernel yields */
+constexpr const int PI_BLOCK_DIGITS = 15;
+
+/* how many digits further than GetNthPiDigit the fixed-point block carries the series, so that its tail stays below the rounding error */
+constexpr const int PI_BLOCK_EXTRA_DIGITS = 8;
+
+/* consecutive digits of pi, as characters */
+struct PiDigitBlock
+{
+	int position = 0; /* position of digits[0] */
+	int count = 0; /* number of digits held, at least 1 */
+	bool guaranteed = false; /* whether all count digits are proven correct. If not, count is 1 and that digit is only the most likely one */
+	char digits[PI_BLOCK_DIGITS + 1] = {}; /* zero terminated */
+};
+
+/* fixed point format GetPiDigitBlock extracts digits in: 0.60, which leaves room to multiply by 10 */
+constexpr const int PI_BLOCK_FRACTION_BITS = 60;
+
+/*
+ * the digits of pi from position pos on that stay the same over the interval from low to high, given in 0.60 fixed point
+ * along with the fraction x. wraps tells whether the exact value may have wrapped around 0 or 1, in which case not even
+ * the first digit is certain and the block holds x's first digit only.
+ */
+inline PiDigitBlock DigitBlockFromInterval(int pos, uint64_t xBits, uint64_t lowBits, uint64_t highBits, bool wraps)
+{
+	const uint64_t mask = ((uint64_t)1 << PI_BLOCK_FRACTION_BITS) - 1;
+
+	PiDigitBlock block;
+	block.position = pos;
+	if (!wraps) {
+		while (block.count < PI_BLOCK_DIGITS) {
+			lowBits *= 10;
+			highBits *= 10;
+			if ((lowBits >> PI_BLOCK_FRACTION_BITS) != (highBits >> PI_BLOCK_FRACTION_BITS))
+				break;
+			block.digits[block.count++] = (char)('0' + (lowBits >> PI_BLOCK_FRACTION_BITS));
+			lowBits &= mask;
+			highBits &= mask;
 		}
+	}
 
-		t = pow_mod(5, n - 1, av);
-		s = mul_mod(s, t, av);
-		sum = fmod(sum + (double)s / (double)av, 1.0);
+	block.guaranteed = block.count > 0;
+	if (!block.guaranteed) {
+		block.digits[0] = (char)('0' + (int)((xBits * 10) >> PI_BLOCK_FRACTION_BITS));
+		block.count = 1;
 	}
-	return (int)(sum * 1e9);
-}
\ No newline at end of file
+	return block;
+}
+
+/* DigitBlockFromInterval for a 0.64 fixed-point fraction x that is within error units of 2^-64 of the exact one */
+inline PiDigitBlock DigitBlockFromFixedPoint(int pos, uint64_t x, uint64_t error)
+{
+	const int shift = 64 - PI_BLOCK_FRACTION_BITS;
+	const bool wraps = x < error || x > UINT64_MAX - error;
+	return DigitBlockFromInterval(pos, x >> shift, (x - error) >> shift, ((x + error) >> shift) + 1, wraps); /* rounded down and up, so the interval only gets wider */
+}
+
+/* the block for position 0, which is before the decimal point and not something the kernel computes */
+inline PiDigitBlock FirstPiDigitBlock()
+{
+	PiDigitBlock block;
+	block.digits[0] = '3';
+	block.count = 1;
+	block.guaranteed = true;
+	return block;
+}
+
+/*
+ * The digits of pi from position pos on that one kernel call can vouch for: those that stay the same over the whole
+ * interval the error bound allows the fraction to be in. How many depends on the accumulator and on how close the digits
+ * that follow come to a run of 0s or 9s. Unlike std::to_string(GetNthPiDigit(pos)), keeps leading zeros.
+ */
+inline PiDigitBlock GetPiDigitBlock(const int pos, const Accumulator accumulator = Accumulator::FixedPoint)
+{
+	if (pos < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
+	if (pos == 0)
+		return FirstPiDigitBlock();
+
+	if (accumulator == Accumulator::Double) {
+		double error;
+		const double x = PiFractionWith<MontgomeryModulus>(pos, DetectSimdLevel(), &error);
+		const bool wraps = x - error < 0 || x + error >= 1;
+		return DigitBlockFromInterval(pos, (uint64_t)ldexp(x, PI_BLOCK_FRACTION_BITS),
+			wraps ? 0 : (uint64_t)ldexp(x - error, PI_BLOCK_FRACTION_BITS), wraps ? 0 : (uint64_t)ceil(ldexp(x + error, PI_BLOCK_FRACTION_BITS)), wraps);
+	}
+
+	uint64_t error;
+	const uint64_t x = PiFixedPointFractionWith<MontgomeryModulus>(pos, DetectSimdLevel(), PI_BLOCK_EXTRA_DIGITS, &error);
+	return DigitBlockFromFixedPoint(pos, x, error);
+}
+
+/*
+ * PiFixedPointFractionWith for the count positions first, first + stride, ..., first + (count - 1) stride, with first >= 1,
+ * for about the price of the last of them. All positions share the series length of the last one, and with it the primes,
+ * their powers and the kernel's work: for an odd prime the contribution to position n is 10^n times a residue that only
+ * depends on the series length, so each position's is the previous one's times 10^stride mod av. Only the prime 2, whose
+ * power depends on the position, goes through the kernel again for each of them, which is linear in N rather than quadratic.
+ * That power grows by one bit for every digit a position is before the last one: positions that end up needing more than 30
+ * of them, about one in eight positions before the last, get a kernel call of their own.
+ */
+template<typename OddModulus>
+void PiFixedPointFractionsWith(const int first, const int count, const int stride, const SimdLevel simd, const int extraDigits, uint64_t* fractions, uint64_t* errors = nullptr)
+{
+	if (first < 1) throw std::runtime_error(std::string("first is 0 or negative."));
+	if (count <= 0)
+		return;
+
+	const int last = first + (count - 1) * stride;
+	const int N = SeriesLength(last, extraDigits);
+	const PrimePowersCache::Snapshot table = SharedPrimePowers().For(N);
+	const size_t primeCount = table->primes.size();
+
+	/* all but table->primes[0], which is 2 */
+	std::vector<int> s(primeCount), avs(primeCount);
+	PrimeContributions<OddModulus>(first, N, table->primes.data() + 1, table->vmax.data() + 1, table->av.data() + 1, primeCount - 1, simd, s.data() + 1, avs.data() + 1);
+
+	int j, n, t, step, vmax, av;
+	for (j = 0; j < count; j++)
+		fractions[j] = 0;
+
+	for (size_t p = 1; p < primeCount; p++) {
+		av = avs[p];
+		t = s[p];
+		step = pow_mod(10, stride, av);
+		for (j = 0; j < count; j++) {
+			fractions[j] += FixedPointFraction(t, av);
+			t = (int)mul_mod(t, step, av);
+		}
+	}
+
+	for (j = 0; j < count; j++) {
+		n = first + j * stride;
+		vmax = table->vmax[0] + (N - n);
+		if (vmax > 30) { /* 2^vmax doesn't fit in an int: n is too far before the last position to share its series length */
+			fractions[j] = PiFixedPointFractionWith<OddModulus>(n, simd, extraDigits, errors ? &errors[j] : nullptr);
+			continue;
+		}
+		if (vmax > 0) {
+			av = 1 << vmax;
+			fractions[j] += FixedPointFraction(PrimeContribution<PrimeTwo, DivisionModulus>(n, N, 2, vmax, av), av);
+		}
+		if (errors)
+			errors[j] = FixedPointErrorBound(primeCount, n, N);
+	}
+}
+
+/* GetNthPiDigit for the count consecutive positions from first on, for about the price of the last of them. Digits past the first few may differ from GetNthPiDigit's, as both are only that precise */
+inline void GetNthPiDigitBatch(const int first, const int count, int* digits)
+{
+	if (first < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
+	if (count <= 0)
+		return;
+
+	int offset = 0;
+	if (first == 0) {
+		digits[0] = 3;
+		offset = 1;
+	}
+	std::vector<uint64_t> fractions(count - offset);
+	PiFixedPointFractionsWith<MontgomeryModulus>(first + offset, count - offset, 1, DetectSimdLevel(), 0, fractions.data());
+	for (int j = offset; j < count; j++)
+		digits[j] = (int)(ldexp((double)fractions[j - offset], -64) * 1e9);
+}
+
+/*
+ * GetPiDigitBlock for the count blocks that start PI_BLOCK_DIGITS apart from first on, for about the price of the last of them.
+ * A block that can't vouch for all its digits leaves a gap before the next one, which a GetPiDigitBlock call can fill.
+ */
+inline void GetPiDigitBlocks(const int first, const int count, PiDigitBlock* blocks)
+{
+	if (first < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
+	if (count <= 0)
+		return;
+
+	int offset = 0;
+	if (first == 0) {
+		blocks[0] = FirstPiDigitBlock();
+		offset = 1;
+	}
+	if (offset == count)
+		return;
+
+	const int start = first + offset * PI_BLOCK_DIGITS;
+	std::vector<uint64_t> fractions(count - offset), errors(count - offset);
+	PiFixedPointFractionsWith<MontgomeryModulus>(start, count - offset, PI_BLOCK_DIGITS, DetectSimdLevel(), PI_BLOCK_EXTRA_DIGITS, fractions.data(), errors.data());
+	for (int j = offset; j < count; j++)
+		blocks[j] = DigitBlockFromFixedPoint(start + (j - offset) * PI_BLOCK_DIGITS, fractions[j - offset], errors[j - offset]);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+#include "bigInteger.h"
+#include "workerPool.h"
+#include "digitsOfPiParallel.h"
+
+// The first digits of PI all at once, from the Chudnovsky series
+//   1 / PI = 12 * sum over k of (-1)^k (6k)! (13591409 + 545140134 k) / ((3k)! (k!)^3 640320^(3k + 3/2)),
+// summed exactly with binary splitting. Each term adds about 14 digits, and the splitting keeps the numbers of a subtree
+// as large as the digits its terms cover, so the work is dominated by the few large multiplications near the root.
+// Computing the first M digits this way costs far less than M calls to GetNthPiDigit, which each cost O(n^2) on their own.
+
+constexpr const double CHUDNOVSKY_DIGITS_PER_TERM = 14.181647462725477; // log10(640320^3 / 1728).
+constexpr const int64_t CHUDNOVSKY_C3_OVER_24 = 10939058860032000; // 640320^3 / 24.
+
+// P, Q and T of the terms from a to b - 1: T / Q is their sum scaled by Q(0, a) / P(0, a), and P / Q is the ratio that takes the sum past b.
+struct ChudnovskySplit
+{
+	BigInteger P;
+	BigInteger Q;
+	BigInteger T;
+};
+
+// The single term k.
+inline ChudnovskySplit ChudnovskyTerm(const int64_t k)
+{
+	ChudnovskySplit term;
+	if (k == 0)
+	{
+		term.P = 1;
+		term.Q = 1;
+	}
+	else
+	{
+		term.P = BigInteger((6 * k - 5) * (2 * k - 1)) * BigInteger(6 * k - 1);
+		term.Q = BigInteger(k * k * k) * BigInteger(CHUDNOVSKY_C3_OVER_24);
+	}
+	term.T = term.P * BigInteger(13591409 + 545140134 * k);
+	if (k & 1) term.T = BigInteger(0) - term.T;
+	return term;
+}
+
+// Terms a to b - 1 from the two halves they're split into at some m.
+inline ChudnovskySplit ChudnovskyMerge(const ChudnovskySplit& left, const ChudnovskySplit& right)
+{
+	return { left.P * right.P, left.Q * right.Q, left.T * right.Q + left.P * right.T };
+}
+
+// Terms a to b - 1, on the calling thread.
+inline ChudnovskySplit ChudnovskySplitRange(const int64_t a, const int64_t b)
+{
+	if (b - a == 1) return ChudnovskyTerm(a);
+	const int64_t m = (a + b) / 2;
+	return ChudnovskyMerge(ChudnovskySplitRange(a, m), ChudnovskySplitRange(m, b));
+}
+
+// ChudnovskySplitRange with the tree spread across pool. The subtrees below a few leaves per thread are split on one thread each,
+// then every level above them is merged with its four products computed in parallel, down to the root's.
+inline ChudnovskySplit ChudnovskySplitParallel(const int64_t a, const int64_t b, WorkerPool& pool = KernelPool())
+{
+	const size_t leaves = (size_t)std::min<int64_t>(b - a, 4 * (int64_t)(pool.Size() + 1));
+	std::vector<ChudnovskySplit> level(leaves);
+	ForEachOnPool(leaves, [&](const size_t i)
+	{
+		level[i] = ChudnovskySplitRange(a + (b - a) * (int64_t)i / (int64_t)leaves, a + (b - a) * (int64_t)(i + 1) / (int64_t)leaves);
+	}, pool);
+
+	while (level.size() > 1)
+	{
+		const size_t pairs = level.size() / 2;
+		const bool root = level.size() == 2;
+		std::vector<ChudnovskySplit> merged(pairs);
+		std::vector<BigInteger> cross(pairs); // left.P * right.T, the second half of the merged T.
+		ForEachOnPool(4 * pairs, [&](const size_t i)
+		{
+			const ChudnovskySplit& left = level[2 * (i / 4)];
+			const ChudnovskySplit& right = level[2 * (i / 4) + 1];
+			ChudnovskySplit& result = merged[i / 4];
+			switch (i % 4)
+			{
+			case 0: if (!root) result.P = left.P * right.P; break; // Nothing goes past the root, so its P is never used.
+			case 1: result.Q = left.Q * right.Q; break;
+			case 2: result.T = left.T * right.Q; break;
+			case 3: cross[i / 4] = left.P * right.T; break;
+			}
+		}, pool);
+		for (size_t i = 0; i < pairs; i++)
+		{
+			merged[i].T = merged[i].T + cross[i];
+		}
+		if (level.size() & 1) merged.push_back(std::move(level.back())); // An odd one out goes up a level unmerged.
+		level = std::move(merged);
+	}
+	return std::move(level[0]);
+}
+
+// The first count digits of PI, "31415..." for count = 5: the character at index i is GetNthPiDigit(i).
+// PI = 426880 sqrt(10005) Q / T over enough terms, evaluated in integers scaled by 10^(count - 1 + GUARD_DIGITS) and truncated.
+// The guard digits absorb the rounding of the square root and of the division, which are off by less than a unit of the last one.
+inline std::string GetPiDigitsChudnovsky(const size_t count, WorkerPool& pool = KernelPool())
+{
+	if (count == 0) return "";
+
+	constexpr const size_t GUARD_DIGITS = 10;
+	const size_t decimals = count - 1 + GUARD_DIGITS;
+	const int64_t terms = (int64_t)(decimals / CHUDNOVSKY_DIGITS_PER_TERM) + 2;
+
+	const ChudnovskySplit sum = ChudnovskySplitParallel(0, terms, pool);
+	const BigInteger root = BigInteger::SquareRoot(BigInteger(10005) * BigInteger::PowerOfTen(2 * decimals));
+	const BigInteger pi = BigInteger(426880) * root * sum.Q / sum.T;
+
+	return pi.ToString().substr(0, count);
+}
@@ -0,0 +1,392 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "digitsOfPi.h"
+#include "primeSieve.h"
+
+// GetNthPiDigit's kernel on the series Gourdon's 2003 algorithm starts from ("Computation of the n-th decimal digit of pi with low memory"):
+//   PI + 3 = sum over k >= 1 of T_k, T_k = k 2^k / C(2k, k) = k k! / (2k - 1)!!.
+// 10^n (PI + 3) has the same fractional part as 10^n PI, and the denominators of the T_k only hold odd primes up to 2N.
+// Like Bellard's, each prime's share of the fractional part of 10^n times the first N terms is a fraction over a power of that prime.
+//
+// What makes it cheaper is the primes p with p^2 > 2N, nearly all of them. Those divide C(2k, k) at most once, exactly when k mod p >= (p + 1) / 2,
+// so their terms come in windows of (p - 1) / 2 consecutive k. Writing k = jp + r, the term mod p splits into G(j) H(r) with
+//   G(j) = 2^j (j!)^2 / (2j + 1)!, H(r) = p T_r mod p,
+// and a whole window sums to 2 (-1)^((p - 1) / 2) G(j). H((p + 1) / 2) and H(p - 1) have closed forms too, so only the last window, cut short by N,
+// takes a loop, from whichever of its ends is nearer. Gourdon sums that one with fast polynomial evaluation, which this doesn't do: it stays O(n^2 / log n),
+// but with far fewer steps per prime than Bellard's N.
+
+// Number of terms for the n'th digit, carried far enough for extraDigits more digits than usual to be right. The terms shrink by about 2 each.
+inline int64_t GourdonSeriesLength(const int64_t n, const int extraDigits = 0)
+{
+	const double N = (n + 20 + extraDigits) * log(10.0) / log(2.0);
+	return (int64_t)(N + 1.5 * log(N) / log(2.0)) + 8; // T_k is about k^1.5 sqrt(PI) / 2^k: the k^1.5 takes a few more terms.
+}
+
+// Bound on the terms of the series past N for the n'th digit. T_k <= 2 k^1.5 / 2^k since C(2k, k) >= 4^k / (2 sqrt(k)), and past the first few terms
+// each is under 2/3 of the one before, so their sum is under 3 times the first.
+inline double GourdonSeriesTailBound(const int64_t n, const int64_t N)
+{
+	return exp(log(6.0) + 1.5 * log(N + 1.0) + n * log(10.0) - (N + 1) * log(2.0));
+}
+
+// a * b mod m, for a, b < m < 2^32.
+inline uint32_t GourdonMulMod(const uint64_t a, const uint64_t b, const uint32_t m)
+{
+	return (uint32_t)(a * b % m);
+}
+
+// Contribution of a prime p with p^2 <= 2N, over its power av = p^vmax <= 2N: Bellard's loop on T_k, with the valuation of p tracked in v.
+// k mod p and (2k - 1) mod p are counted down alongside, so only the factors p divides see a division.
+inline uint32_t GourdonSmallPrimeContribution(const int64_t n, const int64_t N, const uint32_t p, const int vmax, const uint32_t av)
+{
+	const BarrettModulus mod((int)av);
+	uint32_t num = 1, den = 1, s = 0, power[32];
+	power[0] = 1;
+	for (int i = 1; i <= vmax; i++)
+		power[i] = power[i - 1] * p;
+
+	int v = 0; // Valuation of (2k - 1)!! minus that of k!.
+	uint32_t kLeft = p - 1, uLeft = (p - 1) / 2; // Steps until p divides k, and until it divides 2k - 1, first at k = (p + 1) / 2.
+	for (int64_t k = 1; k <= N; k++)
+	{
+		uint32_t t = (uint32_t)k;
+		int vk = 0;
+		if (kLeft == 0)
+		{
+			kLeft = p;
+			while (t % p == 0)
+			{
+				t /= p;
+				vk++;
+			}
+		}
+		kLeft--;
+		v -= vk;
+		num = (uint32_t)mod.Mul(num, t);
+
+		uint32_t u = (uint32_t)(2 * k - 1);
+		if (uLeft == 0)
+		{
+			uLeft = p;
+			while (u % p == 0)
+			{
+				u /= p;
+				v++;
+			}
+		}
+		uLeft--;
+		den = (uint32_t)mod.Mul(den, u);
+		s = (uint32_t)mod.Mul(s, u); // s / den stays the sum so far.
+
+		const int vt = v - vk; // The leading k of T_k brings vk more.
+		if (vt > 0)
+		{
+			s += (uint32_t)mod.Mul(mod.Mul(num, t), power[vmax - vt]);
+			if (s >= av) s -= av;
+		}
+	}
+	s = GourdonMulMod(s, inv_mod_binary(den, av), av);
+	return GourdonMulMod(s, (uint32_t)pow_mod(10 % (int)av, (int)n, (int)av), av);
+}
+
+// Loop over the last window of a large prime p, from whichever end is nearer: H(r) = hn / hd and the sum so far sn / hd, in Montgomery's form.
+// Each step multiplies hn by a and hd and sn by b, two quadratics in r, so a moves by da, which moves by dda, and the same for b.
+// Everything is kept in 64 bits so that the vector kernels load the fields of several windows as they are.
+struct GourdonWindow
+{
+	uint64_t p = 0;
+	uint64_t hn = 1, hd = 1, sn = 0;
+	uint64_t a = 0, da = 0, dda = 0;
+	uint64_t b = 0, db = 0, ddb = 0;
+	int64_t steps = 0;
+	bool fromTop = false; // Stepping down from H(p - 1): what's summed is then taken away from the whole window's sum.
+};
+
+// The last window of p for N terms, before any step. steps is 0 when the window has no k within N with a denominator.
+inline GourdonWindow GourdonWindowStart(const uint32_t p, const int64_t N)
+{
+	const uint32_t h = (p - 1) / 2;
+	const int64_t first = h + 1;
+	const int64_t last = N - (N + 1) / p * (int64_t)p; // The last window's r only goes up to this.
+
+	GourdonWindow window;
+	window.p = p;
+	if (last < first) return window;
+
+	window.fromTop = last - first + 1 > (int64_t)p - 1 - last;
+	if (!window.fromTop)
+	{
+		// H((p + 1) / 2) = ((p + 1) / 2)^2 2^h (-1)^h, with 2^h mod p the Legendre symbol of 2. Then H(r + 1) = H(r) (r + 1)^2 / (r (2r + 1)).
+		window.hn = GourdonMulMod(first, first, p);
+		if (((p % 8 == 1 || p % 8 == 7) ? 1 : -1) * (h % 2 == 0 ? 1 : -1) < 0) window.hn = p - window.hn;
+		window.a = GourdonMulMod(first + 1, first + 1, p); // (r + 1)^2.
+		window.da = (2 * (uint64_t)first + 3) % p;
+		window.dda = 2 % p;
+		window.b = GourdonMulMod(first, 2 * first + 1, p); // r (2r + 1).
+		window.db = (4 * (uint64_t)first + 3) % p;
+		window.ddb = 4 % p;
+		window.steps = last - first + 1;
+	}
+	else
+	{
+		// H(p - 1) = 1 and H(r - 1) = H(r) (r - 1)(2r - 1) / r^2, with r = -1 mod p to start with.
+		window.a = 6 % p; // (r - 1)(2r - 1).
+		window.da = 9 % p; // -(4r - 5).
+		window.dda = 4 % p;
+		window.b = 1; // r^2.
+		window.db = 3 % p; // -(2r - 1).
+		window.ddb = 2 % p;
+		window.steps = (int64_t)p - 1 - last;
+	}
+	return window;
+}
+
+// Takes steps steps of the loop of window.
+inline void GourdonWindowSteps(GourdonWindow& window, const int64_t steps)
+{
+	const MontgomeryModulus mod((int)window.p);
+	const uint64_t p = window.p;
+	uint64_t hn = window.hn, hd = window.hd, sn = window.sn, a = window.a, da = window.da, b = window.b, db = window.db;
+	for (int64_t i = 0; i < steps; i++)
+	{
+		sn += hn;
+		if (sn >= p) sn -= p;
+		hn = (uint64_t)mod.Mul((uint32_t)hn, (uint32_t)a);
+		hd = (uint64_t)mod.Mul((uint32_t)hd, (uint32_t)b);
+		sn = (uint64_t)mod.Mul((uint32_t)sn, (uint32_t)b);
+
+		a += da;
+		if (a >= p) a -= p;
+		da += window.dda;
+		if (da >= p) da -= p;
+		b += db;
+		if (b >= p) b -= p;
+		db += window.ddb;
+		if (db >= p) db -= p;
+	}
+	window.hn = hn;
+	window.hd = hd;
+	window.sn = sn;
+	window.a = a;
+	window.da = da;
+	window.b = b;
+	window.db = db;
+	window.steps -= steps;
+}
+
+#ifdef DIGITS_OF_PI_X86
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi" // Always inlined into a function compiled for Lanes' instruction set, like PrimeContributionsSimd.
+#endif
+
+// GourdonWindowSteps on Lanes::COUNT windows at once, steps steps each. Same residues as the scalar loop, lane by lane.
+template<typename Lanes>
+SIMD_INLINE void GourdonWindowStepsSimd(GourdonWindow* windows, const int64_t steps)
+{
+	constexpr int W = Lanes::COUNT;
+	uint64_t fields[10][W], mInverse[W];
+	int64_t ones[W];
+	for (int i = 0; i < W; i++)
+	{
+		const GourdonWindow& window = windows[i];
+		const uint64_t values[10] = { window.p, window.hn, window.hd, window.sn, window.a, window.da, window.dda, window.b, window.db, window.ddb };
+		for (int f = 0; f < 10; f++)
+			fields[f][i] = values[f];
+		mInverse[i] = MontgomeryModulus((int)window.p).mInverse;
+		ones[i] = 1;
+	}
+
+	const typename Lanes::Mask all = Lanes::Positive(ones);
+	const typename Lanes::Vector m = Lanes::Load(fields[0]), mi = Lanes::Load(mInverse), dda = Lanes::Load(fields[6]), ddb = Lanes::Load(fields[9]);
+	typename Lanes::Vector hn = Lanes::Load(fields[1]), hd = Lanes::Load(fields[2]), sn = Lanes::Load(fields[3]);
+	typename Lanes::Vector a = Lanes::Load(fields[4]), da = Lanes::Load(fields[5]), b = Lanes::Load(fields[7]), db = Lanes::Load(fields[8]);
+	for (int64_t i = 0; i < steps; i++)
+	{
+		sn = Lanes::AddWhere(all, sn, hn, m);
+		hn = Lanes::Mul(hn, a, m, mi);
+		hd = Lanes::Mul(hd, b, m, mi);
+		sn = Lanes::Mul(sn, b, m, mi);
+		a = Lanes::AddWhere(all, a, da, m);
+		da = Lanes::AddWhere(all, da, dda, m);
+		b = Lanes::AddWhere(all, b, db, m);
+		db = Lanes::AddWhere(all, db, ddb, m);
+	}
+
+	Lanes::Store(fields[1], hn);
+	Lanes::Store(fields[2], hd);
+	Lanes::Store(fields[3], sn);
+	Lanes::Store(fields[4], a);
+	Lanes::Store(fields[5], da);
+	Lanes::Store(fields[7], b);
+	Lanes::Store(fields[8], db);
+	for (int i = 0; i < W; i++)
+	{
+		GourdonWindow& window = windows[i];
+		window.hn = fields[1][i];
+		window.hd = fields[2][i];
+		window.sn = fields[3][i];
+		window.a = fields[4][i];
+		window.da = fields[5][i];
+		window.b = fields[7][i];
+		window.db = fields[8][i];
+		window.steps -= steps;
+	}
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+SIMD_TARGET("avx2") inline void GourdonWindowStepsAvx2(GourdonWindow* windows, const int64_t steps)
+{
+	GourdonWindowStepsSimd<Avx2Lanes>(windows, steps);
+}
+
+SIMD_TARGET("avx512f") inline void GourdonWindowStepsAvx512(GourdonWindow* windows, const int64_t steps)
+{
+	GourdonWindowStepsSimd<Avx512Lanes>(windows, steps);
+}
+
+#endif//!DIGITS_OF_PI_X86
+
+// Runs every window to the end of its loop. With a vector kernel, the windows are sorted by length and taken a group of lanes at a time:
+// the group runs together for as long as its shortest, then each finishes on its own, which is little once sorted.
+inline void GourdonRunWindows(std::vector<GourdonWindow>& windows, const SimdLevel simd)
+{
+	int lanes = 0;
+#ifdef DIGITS_OF_PI_X86
+	if (simd == SimdLevel::Avx512)
+		lanes = Avx512Lanes::COUNT;
+	else if (simd == SimdLevel::Avx2)
+		lanes = Avx2Lanes::COUNT;
+#endif
+
+	size_t i = 0;
+	if (lanes != 0)
+	{
+		std::sort(windows.begin(), windows.end(), [](const GourdonWindow& x, const GourdonWindow& y) { return x.steps < y.steps; });
+		for (; i + lanes <= windows.size(); i += lanes)
+		{
+#ifdef DIGITS_OF_PI_X86
+			if (simd == SimdLevel::Avx512)
+				GourdonWindowStepsAvx512(windows.data() + i, windows[i].steps);
+			else
+				GourdonWindowStepsAvx2(windows.data() + i, windows[i].steps);
+#endif
+		}
+	}
+	for (GourdonWindow& window : windows)
+	{
+		GourdonWindowSteps(window, window.steps);
+	}
+}
+
+// Contribution of a prime p with p^2 > 2N, over p: full windows through G, the last one from its finished loop.
+inline uint32_t GourdonLargePrimeContribution(const int64_t n, const int64_t N, const GourdonWindow& window)
+{
+	const uint32_t p = (uint32_t)window.p;
+	const uint32_t h = (p - 1) / 2;
+	const int64_t windows = (N + 1) / p; // Windows j whose last k, jp + p - 1, is within N.
+	const bool partial = N - windows * (int64_t)p > h; // Whether window j = windows has k within N with a denominator.
+
+	// Sum of G(j) for j < windows over gd, and G(j) = gn / gd for the last j stepped to. G(j) = G(j - 1) j / (2j + 1), where 2j + 1 < p as long as
+	// window j has a k within N, since 2N < p^2.
+	uint32_t gn = 1, gd = 1, gs = 0;
+	const auto step = [&](const int64_t j)
+	{
+		gn = GourdonMulMod(gn, (uint64_t)j, p);
+		gd = GourdonMulMod(gd, (uint64_t)(2 * j + 1), p);
+		gs = GourdonMulMod(gs, (uint64_t)(2 * j + 1), p);
+	};
+	for (int64_t j = 0; j < windows; j++)
+	{
+		if (j > 0) step(j);
+		gs += gn;
+		if (gs >= p) gs -= p;
+	}
+
+	if (partial && windows > 0) step(windows);
+
+	const uint32_t whole = h % 2 == 0 ? 2 % p : p - 2; // 2 (-1)^h, what a whole window's H(r) sum to.
+	uint32_t numerator = GourdonMulMod(whole, gs, p), denominator = gd;
+	if (partial)
+	{
+		// Montgomery's factors of R are the same in the window's sum and in hd, so they cancel.
+		const uint32_t pd = (uint32_t)window.hd;
+		const uint32_t pn = window.fromTop ? (GourdonMulMod(whole, pd, p) + p - (uint32_t)window.sn) % p : (uint32_t)window.sn;
+		numerator = (GourdonMulMod(numerator, pd, p) + GourdonMulMod(gn, pn, p)) % p;
+		denominator = GourdonMulMod(denominator, pd, p);
+	}
+
+	const uint32_t s = GourdonMulMod(numerator, inv_mod_binary(denominator, p), p);
+	return GourdonMulMod(s, (uint32_t)pow_mod(10 % (int)p, (int)(n % (p - 1)), (int)p), p); // Fermat: 10^(p - 1) = 1 mod p.
+}
+
+// Fractional part of 10^(pos - 1) PI from Gourdon's series, whose leading decimals are the digits of PI from position pos on, in 0.64 fixed point, with the series carried extraDigits further. Sets *error to a bound in units of 2^-64.
+inline uint64_t GourdonPiFixedPointFraction(const int64_t pos, const int extraDigits = 0, uint64_t* error = nullptr, const SimdLevel simd = DetectSimdLevel())
+{
+	const int64_t N = GourdonSeriesLength(pos, extraDigits);
+	const uint64_t limit = 2 * (uint64_t)N - 1; // Largest factor of a denominator.
+	if (limit >= (uint64_t)INT32_MAX) throw std::runtime_error("Position " + std::to_string(pos) + " is too far for GourdonPiFixedPointFraction.");
+
+	const PrimeTable::Snapshot primes = SharedPrimeTable().PrimesUpTo(limit);
+	uint64_t sum = 0;
+	size_t count = 0;
+	std::vector<GourdonWindow> windows; // Of the large primes, which all run their loops before adding up.
+	for (const uint32_t p : primes->values)
+	{
+		if (p > limit) break;
+		if (p == 2) continue; // Never in a denominator: C(2k, k) has fewer factors of 2 than 2^k.
+		count++;
+
+		if ((uint64_t)p * p > 2 * (uint64_t)N)
+		{
+			windows.push_back(GourdonWindowStart(p, N));
+			continue;
+		}
+
+		uint32_t av = p;
+		int vmax = 1;
+		while ((uint64_t)av * p <= 2 * (uint64_t)N)
+		{
+			av *= p;
+			vmax++;
+		}
+		sum += FixedPointFraction((int)GourdonSmallPrimeContribution(pos - 1, N, p, vmax, av), (int)av);
+	}
+
+	GourdonRunWindows(windows, simd);
+	for (const GourdonWindow& window : windows)
+	{
+		sum += FixedPointFraction((int)GourdonLargePrimeContribution(pos - 1, N, window), (int)window.p);
+	}
+
+	if (error) *error = (uint64_t)count + (uint64_t)ceil(ldexp(GourdonSeriesTailBound(pos, N), 64));
+	return sum;
+}
+
+// GetNthPiDigit with Gourdon's series instead of Bellard's.
+inline int GetNthPiDigitGourdon(const int pos, const SimdLevel simd = DetectSimdLevel())
+{
+	if (pos < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
+	if (pos == 0) return 3;
+
+	return (int)(ldexp((double)GourdonPiFixedPointFraction(pos, 0, nullptr, simd), -64) * 1e9);
+}
+
+constexpr const int GOURDON_MIN_POSITION = 1000; // Where GetNthPiDigitGourdon gets ahead of GetNthPiDigit, with or without vector kernels, staying about twice as fast up to 10^6. Below it they take about as long.
+
+// GetNthPiDigit or GetNthPiDigitGourdon, whichever is faster at pos.
+inline int GetNthPiDigitFastest(const int pos, const SimdLevel simd = DetectSimdLevel())
+{
+	return pos < GOURDON_MIN_POSITION ? GetNthPiDigitWith<MontgomeryModulus>(pos, simd) : GetNthPiDigitGourdon(pos, simd);
+}
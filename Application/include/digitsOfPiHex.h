@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdexcept>
+#include <string>
+
+#include "digitsOfPiWide.h"
+
+// Hexadecimal digits of PI at any position, from the Bailey-Borwein-Plouffe formula
+//   PI = sum over k of 16^-k (4 / (8k + 1) - 2 / (8k + 4) - 1 / (8k + 5) - 1 / (8k + 6)).
+// Multiplying by 16^d only shifts the digits, so the fraction of 16^d PI comes from the d terms where 16^(d - k) mod (8k + j) is an integer,
+// plus a few terms past d that shrink by 16 each. That's O(d log d) per position, against the O(n^2) of GetNthPiDigit's decimal kernel.
+
+constexpr const int PI_HEX_DIGITS = 7; // Hexadecimal digits GetNthPiHexDigit gives, 28 bits so that they fit in an int.
+
+// Fraction of 16^d * sum over k of 16^-k / (8k + j), as a 0.64 fixed-point number. Each term is rounded down, so it's under by at most d + 1 units of 2^-64.
+inline uint64_t PiHexSeriesFraction(const int64_t d, const uint32_t j)
+{
+	uint64_t sum = 0;
+	for (int64_t k = 0; k <= d; k++)
+	{
+		const uint64_t m = 8 * (uint64_t)k + j;
+		const uint64_t r = m <= UINT32_MAX ? PowModFull((uint32_t)16, (uint64_t)(d - k), (uint32_t)m) : PowModFull((uint64_t)16, (uint64_t)(d - k), m); // 32-bit words while the modulus fits, past position 2^29 or so 64-bit ones.
+		sum += WideFixedPointFraction(r, m);
+	}
+	for (int64_t k = d + 1; k - d < 16; k++) // 16^(d - k) / (8k + j), below 2^-64 from 16 terms on.
+	{
+		sum += ((uint64_t)1 << (64 - 4 * (k - d))) / (uint64_t)(8 * k + j);
+	}
+	return sum;
+}
+
+// Fraction of 16^d PI, as a 0.64 fixed-point number: the hexadecimal digits of PI from position d + 1 on. Wraps around, which is taking it mod 1.
+inline uint64_t PiHexFraction(const int64_t d)
+{
+	return 4 * PiHexSeriesFraction(d, 1) - 2 * PiHexSeriesFraction(d, 4) - PiHexSeriesFraction(d, 5) - PiHexSeriesFraction(d, 6);
+}
+
+// GetNthPiDigit in base 16: 3 for pos 0, otherwise the PI_HEX_DIGITS hexadecimal digits from pos on. 0x243F6A8 for pos 1.
+// The rounding of the 8 (d + 1) terms, weights included, stays below 2^-29 for any position an int holds, so the last digit is only off when the ones after it are all F or all 0.
+inline int GetNthPiHexDigit(const int pos)
+{
+	if (pos < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
+	if (pos == 0) return 3;
+
+	return (int)(PiHexFraction(pos - 1) >> (64 - 4 * PI_HEX_DIGITS));
+}
+
+// The hexadecimal digit at pos, as a character. 'F' for pos 4.
+inline char GetNthPiHexCharacter(const int pos)
+{
+	return "0123456789ABCDEF"[pos == 0 ? 3 : GetNthPiHexDigit(pos) >> (4 * PI_HEX_DIGITS - 4)];
+}
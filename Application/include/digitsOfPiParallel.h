@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <latch>
+#include <algorithm>
+#include <functional>
+
+#include "digitsOfPi.h"
+#include "workerPool.h"
+
+// Pool GetNthPiDigitParallel runs on by default. Only ever given jobs that never block, so any thread may wait on it.
+inline WorkerPool& KernelPool()
+{
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+// Calls task(i) for every i below count, on the threads of pool and on the calling thread, and returns once every call has.
+// The tasks must not block, and it must not be called from a job running on pool: the calling thread takes tasks too, but then waits for the ones the workers picked up.
+inline void ForEachOnPool(const size_t count, const std::function<void(size_t)>& task, WorkerPool& pool)
+{
+	// Shared with the jobs, which may only get to run after every task is done and this function has returned.
+	struct Work
+	{
+		size_t count = 0;
+		const std::function<void(size_t)>* task = nullptr; // Only dereferenced while tasks are left, so while the caller is still waiting.
+		std::atomic<size_t> next = 0;
+		std::latch left;
+
+		explicit Work(const size_t tasks) : count(tasks), left((std::ptrdiff_t)tasks) {}
+
+		void Run()
+		{
+			size_t i;
+			while ((i = next.fetch_add(1)) < count)
+			{
+				(*task)(i);
+				left.count_down();
+			}
+		}
+	};
+
+	if (count == 0) return;
+	auto work = std::make_shared<Work>(count);
+	work->task = &task;
+	for (size_t i = 0; i < std::min(pool.Size(), count - 1); i++)
+	{
+		pool.Submit([work]{ work->Run(); });
+	}
+	work->Run();
+	work->left.wait();
+}
+
+// Same result as GetNthPiDigit, bit for bit, but with the primes of the one digit split across the threads of pool.
+// Meant for single positions large enough that one call takes long. Same rules as ForEachOnPool, which it runs on.
+inline int GetNthPiDigitParallel(const int pos, WorkerPool& pool = KernelPool())
+{
+	if (pos < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
+	if (pos == 0) return 3;
+
+	const int N = SeriesLength(pos);
+	const PrimePowersCache::Snapshot table = SharedPrimePowers().For(N);
+	const size_t count = table->primes.size();
+	const SimdLevel simd = DetectSimdLevel();
+
+	// A few chunks per thread so that the threads finishing early can pick up the slack. Multiples of 8 primes keep the vector kernels' lanes full.
+	const size_t threads = pool.Size() + 1;
+	const size_t chunkSize = std::max<size_t>(8, (count / (4 * threads) + 7) / 8 * 8);
+	const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	std::vector<int> s(count), avs(count);
+	ForEachOnPool(chunkCount, [&](const size_t chunk)
+	{
+		const size_t first = chunk * chunkSize;
+		const size_t last = std::min(first + chunkSize, count);
+		PrimeContributions<MontgomeryModulus>(pos, N, table->primes.data() + first, table->vmax.data() + first, table->av.data() + first, last - first, simd, s.data() + first, avs.data() + first);
+	}, pool);
+
+	return (int)(SumContributions(s.data(), avs.data(), count) * 1e9);
+}
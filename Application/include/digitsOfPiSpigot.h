@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+#include "bigInteger.h"
+
+// Gibbons' unbounded spigot ("Unbounded Spigot Algorithms for the Digits of Pi", 2006), the version streaming Lambert's continued fraction.
+// The digits come out in order, one after the other, and the state carries over from one to the next: digit n + 1 costs the handful of
+// steps it takes to pin it down, instead of a whole new series like GetNthPiDigit. Those steps get slower as the state grows, linearly with n.
+class PiSpigot
+{
+public:
+	// The digit at Position(), then moves on to the next one. 3 first.
+	int Next()
+	{
+		while (true)
+		{
+			// Once the remaining terms can't move the value out of [n, n + 1) any more, n is the next digit.
+			if (BigInteger(4) * q + r - t < BigInteger(n) * t)
+			{
+				const int digit = (int)n;
+				const BigInteger nextN = BigInteger(10) * (BigInteger(3) * q + r) / t - BigInteger(10 * n);
+				r = BigInteger(10) * (r - BigInteger(n) * t);
+				q = BigInteger(10) * q;
+				n = nextN.ToInt64();
+				position++;
+				return digit;
+			}
+
+			// Not enough terms to tell yet: compose the state with term k.
+			const BigInteger nextN = (q * BigInteger(7 * k + 2) + r * BigInteger(l)) / (t * BigInteger(l));
+			r = (BigInteger(2) * q + r) * BigInteger(l);
+			q = q * BigInteger(k);
+			t = t * BigInteger(l);
+			n = nextN.ToInt64();
+			k++;
+			l += 2;
+		}
+	}
+
+	// Position of the digit Next returns next.
+	size_t Position() const
+	{
+		return position;
+	}
+
+	// The digit at position, like GetNthPiDigit's first. Cheap when position is Position(), which is when digits are asked for in order.
+	// Skips ahead to a later one, and starts over for an earlier one.
+	int DigitAt(const size_t digitPosition)
+	{
+		if (digitPosition < position) *this = PiSpigot();
+		while (position < digitPosition)
+		{
+			Next();
+		}
+		return Next();
+	}
+
+private:
+	BigInteger q = 1, r = 0, t = 1; // The linear fractional transformation (q x + r) / t the terms so far compose to, with the digits already out scaled away.
+	int64_t n = 3; // Candidate for the next digit.
+	int64_t k = 1; // Index of the next term.
+	int64_t l = 3; // 2k + 1.
+	size_t position = 0;
+};
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include <type_traits>
+#include <stdexcept>
+#include <string>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "digitsOfPi.h"
+#include "primeSieve.h"
+
+// GetNthPiDigit's kernel with positions, primes, prime powers and the loop's factors held in a Word, uint32_t or uint64_t,
+// instead of an int. With uint64_t words products go through 128 bits, which takes positions into the billions.
+// With uint32_t words it covers the same positions GetNthPiDigit does, and the two only differ by the width of their arithmetic.
+
+// Low half of a * b, with the high half in high.
+inline uint32_t MulFull(const uint32_t a, const uint32_t b, uint32_t& high)
+{
+	const uint64_t p = (uint64_t)a * b;
+	high = (uint32_t)(p >> 32);
+	return (uint32_t)p;
+}
+
+inline uint64_t MulFull(const uint64_t a, const uint64_t b, uint64_t& high)
+{
+#ifdef _MSC_VER
+	return _umul128(a, b, &high);
+#else
+	const unsigned __int128 p = (unsigned __int128)a * b;
+	high = (uint64_t)(p >> 64);
+	return (uint64_t)p;
+#endif
+}
+
+// a * b mod m, for a, b < m. With a division, so only meant for outside the k loop.
+inline uint32_t MulModFull(const uint32_t a, const uint32_t b, const uint32_t m)
+{
+	return (uint32_t)((uint64_t)a * b % m);
+}
+
+inline uint64_t MulModFull(const uint64_t a, const uint64_t b, const uint64_t m)
+{
+#ifdef _MSC_VER
+	uint64_t high, remainder;
+	const uint64_t low = _umul128(a, b, &high);
+	_udiv128(high, low, m, &remainder); // The quotient fits in 64 bits since a < m.
+	return remainder;
+#else
+	return (uint64_t)((unsigned __int128)a * b % m);
+#endif
+}
+
+// (a^b) mod m.
+template<typename Word>
+Word PowModFull(Word a, uint64_t b, const Word m)
+{
+	Word r = 1 % m;
+	a %= m;
+	while (b != 0)
+	{
+		if (b & 1) r = MulModFull(r, a, m);
+		b >>= 1;
+		a = MulModFull(a, a, m);
+	}
+	return r;
+}
+
+// Inverse of x mod m, for m < 2^(bits of Word - 1). Same extended Euclid as inv_mod, in the signed type of the same width.
+template<typename Word>
+Word InvModFull(const Word x, const Word m)
+{
+	using Signed = std::make_signed_t<Word>;
+	Signed q, u = (Signed)x, v = (Signed)m, c = 1, a = 0, t;
+	do
+	{
+		q = v / u;
+
+		t = c;
+		c = a - q * c;
+		a = t;
+
+		t = u;
+		u = v - q * u;
+		v = t;
+	} while (u != 0);
+	a = a % (Signed)m;
+	if (a < 0) a += (Signed)m;
+	return (Word)a;
+}
+
+// MontgomeryModulus for any word: R = 2^(bits of Word), odd m < R / 2 so that the sum of two residues still fits.
+template<typename Word>
+struct WordMontgomeryModulus
+{
+	Word m;
+	Word mInverse; // m^-1 mod R.
+	Word r; // R mod m.
+	Word r3; // R^3 mod m.
+
+	explicit WordMontgomeryModulus(const Word av) : m(av)
+	{
+		mInverse = m; // Correct to 3 bits since m * m = 1 mod 8, each Newton step doubles that.
+		for (int i = 0; i < 5; i++)
+		{
+			mInverse *= (Word)2 - m * mInverse;
+		}
+		r = (Word)(0 - m) % m;
+		r3 = MulModFull(MulModFull(r, r, m), r, m);
+	}
+
+	// x * y / R mod m, for x < m.
+	inline Word Mul(const Word x, const Word y) const
+	{
+		Word high, qmHigh;
+		const Word low = MulFull(x, y, high);
+		const Word q = low * mInverse; // q * m = x * y mod R, so their difference is a multiple of R and the low halves cancel out.
+		MulFull(q, m, qmHigh);
+		return high >= qmHigh ? high - qmHigh : high - qmHigh + m;
+	}
+	inline Word Lift(const Word x) const { return MulModFull(x, r, m); }
+	inline Word Finish(const Word s) const { return Mul(s, r3); }
+	inline Word Inverse(const Word x) const { return inv_mod_binary(x, m); }
+};
+
+// For a = 2, where av is a power of two and reducing is masking.
+template<typename Word>
+struct WordPowerOfTwoModulus
+{
+	Word mask;
+
+	explicit WordPowerOfTwoModulus(const Word av) : mask(av - 1) {}
+
+	inline Word Mul(const Word x, const Word y) const { return (Word)(x * y) & mask; }
+	inline Word Lift(const Word x) const { return x; }
+	inline Word Finish(const Word s) const { return s; }
+
+	// x^-1 mod av, for odd x: Newton's iteration, as for MontgomeryModulus's mInverse, then truncated to av.
+	inline Word Inverse(const Word x) const
+	{
+		Word y = x;
+		for (int i = 0; i < 5; i++)
+		{
+			y *= (Word)2 - x * y;
+		}
+		return y & mask;
+	}
+};
+
+// Whether every quantity the kernel handles for a series of N terms fits in a Word: the factors up to 25N, and sums of two prime powers up to 3N.
+template<typename Word>
+inline bool FitsWord(const int64_t N)
+{
+	const double bits = 8 * sizeof(Word);
+	return 25.0 * N < ldexp(1.0, (int)bits) && 3.0 * N < ldexp(1.0, (int)bits - 1);
+}
+
+// SeriesLength for positions past what an int holds.
+inline int64_t WideSeriesLength(const int64_t n, const int extraDigits = 0)
+{
+	return (int64_t)((n + 20 + extraDigits) * log(10.0) / log(13.5));
+}
+
+// s / av as a 0.64 fixed-point fraction, rounded down, for s < av.
+inline uint64_t WideFixedPointFraction(const uint64_t s, const uint64_t av)
+{
+#ifdef _MSC_VER
+	uint64_t remainder;
+	return _udiv128(s, 0, av, &remainder);
+#else
+	return (uint64_t)(((unsigned __int128)s << 64) / av);
+#endif
+}
+
+// PrimeContribution with Inversion::Once, in Words. n and N are 64 bits whatever the word, kq1 to kq4 are signed for DIVN.
+// Specialized for PrimeTwo and OddPrime like PrimeContribution, which also picks the modulus: masking for 2, Montgomery for the others.
+template<typename Word, typename Prime>
+Word WidePrimeContribution(const int64_t n, const int64_t N, const Word a, const int64_t vmax, const Word av)
+{
+	constexpr bool two = std::is_same<Prime, PrimeTwo>::value;
+	using Modulus = std::conditional_t<two, WordPowerOfTwoModulus<Word>, WordMontgomeryModulus<Word>>;
+	const Modulus mod(av);
+	const Word aLifted = mod.Lift(a % av);
+	const int64_t divisor = (int64_t)a;
+
+	Word num, den = 1, s = 0, t;
+	int64_t k, v, i, tz, kq1 = 0, kq2 = -1, kq3 = -3, kq4 = -2;
+	if (two)
+	{
+		num = 1;
+		v = -n;
+	}
+	else
+	{
+		num = PowModFull((Word)2, (uint64_t)n, av);
+		v = 0;
+	}
+
+	for (k = 1; k <= N; k++)
+	{
+		if constexpr (two)
+		{
+			t = (Word)k;
+			tz = ctz(t);
+			t >>= tz; // 2k without its factors of two.
+			v -= tz + 1;
+			num = mod.Mul(num, t);
+
+			t = (Word)(2 * k - 1);
+			num = mod.Mul(num, t);
+
+			t = (Word)(3 * (3 * k - 1));
+			tz = ctz(t);
+			t >>= tz;
+			v += tz;
+			den = mod.Mul(den, t);
+			s = mod.Mul(s, t);
+
+			t = (Word)(3 * k - 2);
+			tz = ctz(t);
+			t >>= tz;
+			v += tz + 1; // The 2 the odd primes multiply den by.
+			den = mod.Mul(den, t);
+			s = mod.Mul(s, t);
+		}
+		else
+		{
+			t = (Word)(2 * k);
+			DIVN(t, divisor, v, -1, kq1, 2);
+			num = mod.Mul(num, t);
+
+			t = (Word)(2 * k - 1);
+			DIVN(t, divisor, v, -1, kq2, 2);
+			num = mod.Mul(num, t);
+
+			t = (Word)(3 * (3 * k - 1));
+			DIVN(t, divisor, v, 1, kq3, 9);
+			den = mod.Mul(den, t);
+			s = mod.Mul(s, t);
+
+			t = (Word)(3 * k - 2);
+			DIVN(t, divisor, v, 1, kq4, 3);
+			t = t * 2;
+			den = mod.Mul(den, t);
+			s = mod.Mul(s, t);
+		}
+
+		if (v > 0)
+		{
+			t = num;
+			for (i = v; i < vmax; i++)
+			{
+				t = mod.Mul(t, aLifted);
+			}
+			t = mod.Mul(t, (Word)(25 * k - 3));
+			s += t;
+			if (s >= av) s -= av;
+		}
+	}
+
+	s = mod.Mul(s, mod.Inverse(den));
+	s = mod.Finish(s);
+	return MulModFull(s, PowModFull((Word)5, (uint64_t)(n - 1), av), av);
+}
+
+// PiFixedPointFractionWith for positions up to the billions, with Word arithmetic. Primes come from ForEachPrime, so memory stays small however far pos is.
+template<typename Word>
+uint64_t WidePiFixedPointFraction(const int64_t pos, const int extraDigits = 0, uint64_t* error = nullptr)
+{
+	const int64_t N = WideSeriesLength(pos, extraDigits);
+	if (!FitsWord<Word>(N)) throw std::runtime_error("Position " + std::to_string(pos) + " needs wider words.");
+
+	const uint64_t limit = 3 * (uint64_t)N;
+	uint64_t sum = 0;
+	size_t count = 0;
+	SharedPrimeTable().ForEachPrime(2, limit, [&](const uint64_t prime)
+	{
+		count++;
+		const Word a = (Word)prime;
+
+		// Largest power of a up to 3N, without the rounding of a floating point log.
+		Word av = a;
+		int64_t vmax = 1;
+		while (av <= limit / a)
+		{
+			av *= a;
+			vmax++;
+		}
+
+		Word s;
+		if (a == 2)
+		{
+			vmax += N - pos;
+			if (vmax <= 0) return; // Contributes nothing.
+			if (vmax > 8 * (int64_t)sizeof(Word) - 2) throw std::runtime_error("Position " + std::to_string(pos) + " needs a power of two wider than its words.");
+			av = (Word)1 << vmax;
+			s = WidePrimeContribution<Word, PrimeTwo>(pos, N, a, vmax, av);
+		}
+		else
+		{
+			s = WidePrimeContribution<Word, OddPrime>(pos, N, a, vmax, av);
+		}
+		sum += WideFixedPointFraction(s, av);
+	});
+
+	if (error) *error = FixedPointErrorBound(count, pos, N);
+	return sum;
+}
+
+// GetNthPiDigit with the given word.
+template<typename Word>
+int GetNthPiDigitWideWith(const int64_t pos)
+{
+	if (pos < 0) throw std::runtime_error(std::string("pos is 0 or negative."));
+	if (pos == 0) return 3;
+
+	return (int)(ldexp((double)WidePiFixedPointFraction<Word>(pos), -64) * 1e9);
+}
+
+// GetNthPiDigit for any position a 64-bit integer holds. Takes 32-bit words when they're wide enough, since those are faster.
+inline int GetNthPiDigitWide(const int64_t pos)
+{
+	if (FitsWord<uint32_t>(WideSeriesLength(pos))) return GetNthPiDigitWideWith<uint32_t>(pos);
+	return GetNthPiDigitWideWith<uint64_t>(pos);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <thread>
+#include <cstdint>
+
+#include "cacheLine.h"
+
+// Bounded lock-free queue any number of producer and consumer threads can use at once. Dmitry Vyukov's design:
+// every slot carries a sequence number telling whether it's ready to be written to or read from for a given lap around the ring,
+// so producers and consumers only contend on their own index and otherwise on different slots.
+template<typename T, size_t Capacity>
+class MpmcQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity of a MpmcQueue must be a power of two greater than 1.");
+
+public:
+	MpmcQueue()
+	{
+		for (size_t i = 0; i < Capacity; i++)
+		{
+			slots[i].sequence.store(i, std::memory_order_relaxed); // Slot i is free for the push number i.
+		}
+	}
+
+	// Returns false without blocking if the queue is full.
+	bool TryPush(const T& item)
+	{
+		size_t pos = tail.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true)
+		{
+			slot = &slots[pos & (Capacity - 1)];
+			const size_t sequence = slot->sequence.load(std::memory_order_acquire); // Synchronizes with the consumer that freed the slot.
+			const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+			if (diff == 0)
+			{
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break; // Slot is ours.
+			}
+			else if (diff < 0)
+			{
+				return false; // The slot still holds an item from the previous lap: queue is full.
+			}
+			else
+			{
+				pos = tail.load(std::memory_order_relaxed); // Another producer took this slot, try again with the next one.
+			}
+		}
+		slot->item = item;
+		slot->sequence.store(pos + 1, std::memory_order_release); // Publishes the item to consumers.
+		return true;
+	}
+
+	// Returns false without blocking if the queue is empty.
+	bool TryPop(T& item)
+	{
+		size_t pos = head.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true)
+		{
+			slot = &slots[pos & (Capacity - 1)];
+			const size_t sequence = slot->sequence.load(std::memory_order_acquire); // Synchronizes with the producer that filled the slot.
+			const intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+			if (diff == 0)
+			{
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break; // Item is ours.
+			}
+			else if (diff < 0)
+			{
+				return false; // Slot hasn't been filled for this lap yet: queue is empty.
+			}
+			else
+			{
+				pos = head.load(std::memory_order_relaxed); // Another consumer took this item, try again with the next one.
+			}
+		}
+		item = slot->item;
+		slot->sequence.store(pos + Capacity, std::memory_order_release); // Frees the slot for the producer of the next lap.
+		return true;
+	}
+
+	// Yields the thread until there's room for item.
+	void Push(const T& item)
+	{
+		while (!TryPush(item))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Yields the thread until there's an item to pop.
+	T Pop()
+	{
+		T item;
+		while (!TryPop(item))
+		{
+			std::this_thread::yield();
+		}
+		return item;
+	}
+
+private:
+	struct alignas(CACHE_LINE_SIZE) Slot
+	{
+		std::atomic<size_t> sequence = 0;
+		T item = {};
+	};
+
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> head = 0; // Number of pops claimed so far.
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail = 0; // Number of pushes claimed so far.
+	std::array<Slot, Capacity> slots;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+#include "primeSieve.h"
+
+// What GetNthPiDigit's kernel needs to know about the primes of a series of N terms: every prime up to 3N, the largest
+// exponent vmax with prime^vmax <= 3N, and that power av. A structure of arrays, so a pass over one of them streams through contiguous memory.
+struct PrimePowers
+{
+	int N = 0;
+	std::vector<uint32_t> primes;
+	std::vector<int> vmax;
+	std::vector<int> av;
+};
+
+// PrimePowers for the series lengths in use, built once per N and shared by every call and thread that needs the same one.
+// Direct-mapped on N: consecutive positions have consecutive series lengths, so the ones a batch of producers works on don't evict each other.
+class PrimePowersCache
+{
+public:
+	using Snapshot = std::shared_ptr<const PrimePowers>;
+
+	// Never waits on another thread's build: two threads missing on the same N both build the table and one of them wins the slot, which only costs the time of a build.
+	// The slots themselves aren't lock-free, std::atomic<std::shared_ptr> takes a short internal lock in libstdc++ around each load and store.
+	Snapshot For(const int N)
+	{
+		std::atomic<Snapshot>& slot = slots[(size_t)N % SLOT_COUNT];
+		Snapshot snapshot = slot.load(std::memory_order_acquire);
+		if (snapshot && snapshot->N == N) return snapshot;
+
+		snapshot = Build(N);
+		slot.store(snapshot, std::memory_order_release);
+		return snapshot;
+	}
+
+private:
+	static constexpr const size_t SLOT_COUNT = 64;
+
+	static Snapshot Build(const int N)
+	{
+		const uint64_t limit = 3 * (uint64_t)N;
+		const PrimeTable::Snapshot primes = SharedPrimeTable().PrimesUpTo(limit);
+		const auto end = std::upper_bound(primes->values.begin(), primes->values.end(), (uint32_t)limit);
+
+		auto table = std::make_shared<PrimePowers>();
+		table->N = N;
+		table->primes.assign(primes->values.begin(), end);
+		table->vmax.resize(table->primes.size());
+		table->av.resize(table->primes.size());
+		for (size_t p = 0; p < table->primes.size(); p++)
+		{
+			// Largest power up to 3N, with integers rather than the rounding of a floating point log.
+			const uint64_t a = table->primes[p];
+			uint64_t av = a;
+			int vmax = 1;
+			while (av * a <= limit)
+			{
+				av *= a;
+				vmax++;
+			}
+			table->vmax[p] = vmax;
+			table->av[p] = (int)av;
+		}
+		return table;
+	}
+
+	std::array<std::atomic<Snapshot>, SLOT_COUNT> slots;
+};
+
+// The cache GetNthPiDigit takes its PrimePowers from.
+inline PrimePowersCache& SharedPrimePowers()
+{
+	static PrimePowersCache cache;
+	return cache;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+// Every prime up to some limit, in increasing order, grown on demand with a segmented sieve of Eratosthenes.
+// Readers get an immutable snapshot, so once the table is big enough they share it without waiting on a grow. Loading the snapshot
+// isn't lock-free itself: std::atomic<std::shared_ptr> guards the pointer with a short internal lock in libstdc++, held only for the copy.
+class PrimeTable
+{
+public:
+	struct Primes
+	{
+		std::vector<uint32_t> values; // Every prime up to limit, in increasing order.
+		uint64_t limit = 1; // Largest number that has been sieved.
+	};
+	using Snapshot = std::shared_ptr<const Primes>;
+
+	// Returns a snapshot holding at least every prime up to limit. Only takes growing, and sieves, when the table has to grow.
+	Snapshot PrimesUpTo(const uint64_t limit)
+	{
+		Snapshot snapshot = primes.load(std::memory_order_acquire);
+		if (snapshot->limit >= limit) return snapshot;
+
+		std::unique_lock<std::mutex> lck(growing);
+		snapshot = primes.load(std::memory_order_acquire);
+		if (snapshot->limit >= limit) return snapshot; // Another thread grew it while we were waiting.
+
+		snapshot = Grow(*snapshot, std::max(limit, 2 * snapshot->limit)); // Doubling keeps the number of regrowths logarithmic.
+		primes.store(snapshot, std::memory_order_release);
+		return snapshot;
+	}
+
+	// Calls visit(p) for every prime p from first to last, in increasing order. Sieves one segment at a time instead of
+	// storing them, so it goes past what the table can hold with memory in O(sqrt(last)). Only the primes up to sqrt(last) come from the table.
+	template<typename Visit>
+	void ForEachPrime(const uint64_t first, const uint64_t last, Visit&& visit)
+	{
+		const Snapshot base = PrimesUpTo(SquareRoot(last));
+
+		std::vector<uint8_t> isComposite(SEGMENT_SIZE);
+		for (uint64_t low = std::max(first, (uint64_t)2); low <= last; low += SEGMENT_SIZE)
+		{
+			const uint64_t high = std::min(low + SEGMENT_SIZE - 1, last);
+			SieveSegment(low, high, base->values, isComposite);
+			for (uint64_t n = low; n <= high; n++)
+			{
+				if (!isComposite[n - low])
+				{
+					visit(n);
+				}
+			}
+			if (high == last) break; // low + SEGMENT_SIZE could wrap around otherwise.
+		}
+	}
+
+private:
+	static constexpr const uint64_t SEGMENT_SIZE = 32 * 1024; // Numbers sieved at once, sized so a segment stays in L1.
+
+	// Copies what old holds and sieves the numbers from old.limit + 1 up to limit, one segment at a time.
+	static Snapshot Grow(const Primes& old, const uint64_t limit)
+	{
+		auto grown = std::make_shared<Primes>();
+		grown->values.reserve(EstimatePrimeCount(limit));
+		grown->values = old.values;
+
+		// Primes up to sqrt(limit) are enough to cross out every composite up to limit. Sieve them first if old doesn't have them.
+		const uint64_t root = SquareRoot(limit);
+		std::vector<uint32_t> base = old.limit >= root ? old.values : Grow(old, root)->values;
+
+		std::vector<uint8_t> isComposite(SEGMENT_SIZE);
+		for (uint64_t low = old.limit + 1; low <= limit; low += SEGMENT_SIZE)
+		{
+			const uint64_t high = std::min(low + SEGMENT_SIZE - 1, limit);
+			SieveSegment(low, high, base, isComposite);
+
+			for (uint64_t n = std::max(low, (uint64_t)2); n <= high; n++)
+			{
+				if (!isComposite[n - low])
+				{
+					grown->values.push_back((uint32_t)n);
+				}
+			}
+		}
+
+		grown->limit = limit;
+		return grown;
+	}
+
+	// Marks the composites from low to high, for high - low < SEGMENT_SIZE, given every prime up to sqrt(high) in base.
+	static void SieveSegment(const uint64_t low, const uint64_t high, const std::vector<uint32_t>& base, std::vector<uint8_t>& isComposite)
+	{
+		std::fill(isComposite.begin(), isComposite.end(), 0);
+		for (const uint32_t p : base)
+		{
+			if ((uint64_t)p * p > high) break;
+			uint64_t multiple = std::max((uint64_t)p * p, (low + p - 1) / p * p); // Smaller multiples were crossed out by smaller primes.
+			for (; multiple <= high; multiple += p)
+			{
+				isComposite[multiple - low] = 1;
+			}
+		}
+	}
+
+	// Largest r with r * r <= x.
+	static uint64_t SquareRoot(const uint64_t x)
+	{
+		uint64_t r = (uint64_t)std::sqrt((double)x);
+		while (r * r > x) r--;
+		while ((r + 1) * (r + 1) <= x) r++;
+		return r;
+	}
+
+	// Upper bound on the number of primes up to x, good enough for reserving memory.
+	static size_t EstimatePrimeCount(const uint64_t x)
+	{
+		if (x < 17) return 8;
+		return (size_t)(1.26 * x / std::log((double)x));
+	}
+
+	std::atomic<Snapshot> primes = std::make_shared<const Primes>();
+	std::mutex growing; // Only one thread grows the table at a time, the others wait for it and use its result.
+};
+
+// The table GetNthPiDigit takes its primes from, shared by every thread computing digits.
+inline PrimeTable& SharedPrimeTable()
+{
+	static PrimeTable table;
+	return table;
+}
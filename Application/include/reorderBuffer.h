@@ -0,0 +1,60 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <cassert>
+
+// Collects items that are completed out of order and releases them in the order of their sequence numbers.
+// Used between producers computing digits of PI in parallel and the consumers that need to see them in order.
+template<typename T>
+class ReorderBuffer
+{
+public:
+	// Drops anything still pending and makes firstSequence the next sequence number to be released.
+	void Reset(const size_t firstSequence = 0)
+	{
+		std::unique_lock<std::mutex> lck(m);
+		assert(!releasing && "Resetting a ReorderBuffer while a thread is releasing from it!");
+		pending.clear();
+		next = firstSequence;
+	}
+
+	// Stores item under sequence. Then, unless another thread is already doing so, calls release(item) for every item of the completed contiguous prefix, in order.
+	// release is called without the internal lock held so it may block, only ever one thread at a time calls it.
+	template<typename Release>
+	void Push(const size_t sequence, T item, Release&& release)
+	{
+		std::unique_lock<std::mutex> lck(m);
+
+		assert(sequence >= next && "Sequence number has already been released!");
+		const size_t offset = sequence - next;
+		if (pending.size() <= offset)
+		{
+			pending.resize(offset + 1);
+		}
+		pending[offset] = std::move(item);
+
+		if (releasing) return; // The thread that is releasing will pick this item up once it reaches it.
+		releasing = true;
+
+		while (!pending.empty() && pending.front().has_value())
+		{
+			T ready = std::move(*pending.front());
+			pending.pop_front();
+			next++;
+
+			lck.unlock();
+			release(ready);
+			lck.lock();
+		}
+
+		releasing = false;
+	}
+
+private:
+	std::mutex m;
+	std::deque<std::optional<T>> pending; // pending[i] holds the item with sequence number next + i once it has been pushed.
+	size_t next = 0; // Sequence number of the next item to release.
+	bool releasing = false; // Whether a thread is currently releasing items. Ensures items are released by one thread at a time, hence in order.
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <thread>
+
+#include "cacheLine.h"
+
+// Bounded lock-free channel between exactly one producer thread and one consumer thread.
+// The producer can run up to Capacity items ahead of the consumer without either of them having to go through the OS.
+template<typename T, size_t Capacity>
+class SpscRing
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity of a SpscRing must be a power of two.");
+
+public:
+	// Producer side. Returns false without blocking if the ring is full.
+	bool TryPush(const T& item)
+	{
+		const size_t t = tail.load(std::memory_order_relaxed); // Only the producer writes tail.
+		if (t - cachedHead == Capacity)
+		{
+			cachedHead = head.load(std::memory_order_acquire); // Synchronizes with the consumer having read the slot it freed.
+			if (t - cachedHead == Capacity) return false;
+		}
+		slots[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release); // Publishes the slot to the consumer.
+		return true;
+	}
+
+	// Consumer side. Returns false without blocking if the ring is empty.
+	bool TryPop(T& item)
+	{
+		const size_t h = head.load(std::memory_order_relaxed); // Only the consumer writes head.
+		if (h == cachedTail)
+		{
+			cachedTail = tail.load(std::memory_order_acquire); // Synchronizes with the producer having written the slot.
+			if (h == cachedTail) return false;
+		}
+		item = slots[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release); // Hands the slot back to the producer.
+		return true;
+	}
+
+	// Producer side. Yields the thread until there's room for item.
+	void Push(const T& item)
+	{
+		while (!TryPush(item))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Consumer side. Yields the thread until there's an item to pop.
+	T Pop()
+	{
+		T item;
+		while (!TryPop(item))
+		{
+			std::this_thread::yield();
+		}
+		return item;
+	}
+
+private:
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> head = 0; // Number of items popped so far. Written by the consumer.
+	size_t cachedTail = 0; // Consumer's last seen value of tail, saves it from touching the producer's cache line on every pop.
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail = 0; // Number of items pushed so far. Written by the producer.
+	size_t cachedHead = 0; // Producer's last seen value of head, saves it from touching the consumer's cache line on every push.
+	alignas(CACHE_LINE_SIZE) std::array<T, Capacity> slots = {};
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+#include <easy/profiler.h> // Used on Windows builds.
+
+#include "cacheLine.h"
+
+// Chase-Lev work-stealing deque, with the memory orderings of Lê, Pop, Cohen and Zappa Nardelli's "Correct and Efficient Work-Stealing for Weak Memory Models".
+// Its owner pushes and pops at the bottom, any other thread steals from the top. Bounded: the owner must not push more than the capacity it was Reset with.
+template<typename T>
+class ChaseLevDeque
+{
+public:
+	enum class StealResult
+	{
+		Success,
+		Empty,
+		Lost, // Another thread took the item first, the deque may still hold more.
+	};
+
+	// Empties the deque and makes room for at least capacity items. Must not be called while other threads use it.
+	void Reset(const size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity) size <<= 1;
+		if (size != slots.size())
+		{
+			slots = std::vector<std::atomic<T>>(size);
+		}
+		mask = (int64_t)size - 1;
+		top.store(0, std::memory_order_relaxed);
+		bottom.store(0, std::memory_order_relaxed);
+	}
+
+	// Owner only.
+	void Push(const T& item)
+	{
+		const int64_t b = bottom.load(std::memory_order_relaxed);
+		assert(b - top.load(std::memory_order_acquire) <= mask && "ChaseLevDeque is full!");
+		slots[b & mask].store(item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release); // Makes the item visible before the new bottom.
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	// Owner only. Takes the most recently pushed item.
+	bool TryPop(T& item)
+	{
+		const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed); // Reserve the bottom item before looking at top...
+		std::atomic_thread_fence(std::memory_order_seq_cst); // ...and make sure thieves see that reservation before we read top.
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b) // Was already empty.
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = slots[b & mask].load(std::memory_order_relaxed);
+		if (t == b) // Last item: race the thieves for it.
+		{
+			const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	}
+
+	// Any thread. Takes the least recently pushed item.
+	StealResult TrySteal(T& item)
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b) return StealResult::Empty;
+
+		item = slots[t & mask].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return StealResult::Lost;
+		}
+		return StealResult::Success;
+	}
+
+private:
+	alignas(CACHE_LINE_SIZE) std::atomic<int64_t> top = 0; // Index of the oldest item. Advanced by thieves and by the owner taking the last item.
+	alignas(CACHE_LINE_SIZE) std::atomic<int64_t> bottom = 0; // Index past the newest item. Only written by the owner.
+	std::vector<std::atomic<T>> slots;
+	int64_t mask = -1;
+};
+
+// Runs jobs over a list of digit positions on a fixed set of threads. Each thread owns a ChaseLevDeque of positions,
+// and when it runs out of its own it steals from the others, so no thread sits idle while another still has a backlog of expensive digits.
+class WorkStealingExecutor
+{
+public:
+	using Job = std::function<void(size_t /*workerId*/, size_t /*position*/)>;
+
+	// Sized to the number of hardware threads, but at least two so that there's someone to steal from.
+	WorkStealingExecutor(): WorkStealingExecutor(std::max(2u, std::thread::hardware_concurrency())) {}
+
+	explicit WorkStealingExecutor(const size_t workerCount)
+	{
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			workers.push_back(std::make_unique<Worker>());
+		}
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			workers[i]->thread = std::thread(&WorkStealingExecutor::Work, this, i);
+		}
+	}
+
+	~WorkStealingExecutor()
+	{
+		{
+			std::unique_lock<std::mutex> lck(m);
+			stopping = true;
+		}
+		cv_start.notify_all();
+		for (auto& worker : workers)
+		{
+			worker->thread.join();
+		}
+	}
+
+	WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+	WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+	// Calls job(workerId, position) once for every position and blocks until all calls have returned.
+	// Positions are dealt round-robin in the given order and every worker runs its own share in that order: put the ones you want started first at the front.
+	void Run(const std::vector<size_t>& positions, Job job)
+	{
+		const size_t workerCount = workers.size();
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			workers[i]->deque.Reset(positions.size() / workerCount + 1);
+		}
+		for (size_t i = positions.size(); i-- > 0;) // Pushed back to front since owners pop the last pushed item first.
+		{
+			workers[i % workerCount]->deque.Push(positions[i]);
+		}
+
+		std::unique_lock<std::mutex> lck(m);
+		currentJob = std::move(job);
+		running = workerCount;
+		generation++;
+		cv_start.notify_all();
+		cv_done.wait(lck, [this]{return running == 0;});
+		currentJob = nullptr;
+	}
+
+	size_t Size() const
+	{
+		return workers.size();
+	}
+
+private:
+	struct Worker
+	{
+		ChaseLevDeque<size_t> deque;
+		std::thread thread;
+	};
+
+	void Work(const size_t id)
+	{
+		EASY_THREAD("Stealer");
+
+		size_t seenGeneration = 0;
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lck(m);
+				cv_start.wait(lck, [&]{return stopping || generation != seenGeneration;});
+				if (stopping) return;
+				seenGeneration = generation;
+				job = currentJob;
+			}
+
+			RunUntilNothingLeft(id, job);
+
+			std::unique_lock<std::mutex> lck(m);
+			if (--running == 0)
+			{
+				cv_done.notify_one();
+			}
+		}
+	}
+
+	// No new positions appear during a run, so once every deque has been seen empty there's nothing left for this worker to do.
+	void RunUntilNothingLeft(const size_t id, const Job& job)
+	{
+		const size_t workerCount = workers.size();
+		size_t position;
+
+		while (workers[id]->deque.TryPop(position))
+		{
+			job(id, position);
+		}
+
+		bool mightHaveWork = true;
+		while (mightHaveWork)
+		{
+			mightHaveWork = false;
+			for (size_t offset = 1; offset < workerCount; offset++)
+			{
+				ChaseLevDeque<size_t>& victim = workers[(id + offset) % workerCount]->deque;
+				const auto result = victim.TrySteal(position);
+				if (result == ChaseLevDeque<size_t>::StealResult::Success)
+				{
+					job(id, position);
+					mightHaveWork = true;
+					break; // Go around again starting from the next worker over.
+				}
+				if (result == ChaseLevDeque<size_t>::StealResult::Lost)
+				{
+					mightHaveWork = true;
+				}
+			}
+		}
+	}
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::mutex m; // Protects everything below.
+	std::condition_variable cv_start; // Signaled when a run starts or the executor is stopping.
+	std::condition_variable cv_done; // Signaled when the last worker of a run has nothing left to do.
+	Job currentJob;
+	size_t generation = 0; // Incremented once per run, tells workers a new run has started.
+	size_t running = 0; // Number of workers that haven't finished the current run yet.
+	bool stopping = false;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+#include <easy/profiler.h> // Used on Windows builds.
+
+// Fixed set of threads running the jobs submitted to it in submission order.
+// Lets the strategies in main.cpp reuse the same OS threads instead of creating and joining two of them per digit.
+class WorkerPool
+{
+public:
+	// Sized to the number of hardware threads, but at least two so that the strategies that rely on threads racing each other still do.
+	WorkerPool(): WorkerPool(std::max(2u, std::thread::hardware_concurrency())) {}
+
+	explicit WorkerPool(const size_t workerCount)
+	{
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back(&WorkerPool::Work, this);
+		}
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::unique_lock<std::mutex> lck(m);
+			stopping = true;
+		}
+		cv_job.notify_all();
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Queues function(args...) to be run by one of the workers. Same calling convention as std::thread's constructor.
+	template<typename Function, typename... Args>
+	void Submit(Function&& function, Args&&... args)
+	{
+		{
+			std::unique_lock<std::mutex> lck(m);
+			jobs.emplace_back(std::bind(std::forward<Function>(function), std::forward<Args>(args)...));
+		}
+		cv_job.notify_one();
+	}
+
+	// Blocks until every job submitted so far has finished running. Must not be called from one of the workers.
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lck(m);
+		cv_idle.wait(lck, [this]{return jobs.empty() && busy == 0;});
+	}
+
+	size_t Size() const
+	{
+		return workers.size();
+	}
+
+private:
+	void Work()
+	{
+		EASY_THREAD("Worker");
+
+		std::unique_lock<std::mutex> lck(m);
+		while (true)
+		{
+			cv_job.wait(lck, [this]{return stopping || !jobs.empty();});
+			if (jobs.empty()) return; // Only happens when stopping: jobs still queued at destruction get to run first.
+
+			std::function<void()> job = std::move(jobs.front());
+			jobs.pop_front();
+			busy++;
+
+			lck.unlock();
+			job();
+			lck.lock();
+
+			busy--;
+			if (jobs.empty() && busy == 0)
+			{
+				cv_idle.notify_all();
+			}
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs; // Jobs waiting for a worker, in submission order.
+	std::mutex m; // Protects jobs, busy and stopping.
+	std::condition_variable cv_job; // Signaled when a job is queued or the pool is stopping.
+	std::condition_variable cv_idle; // Signaled when the last running job finishes with nothing left queued.
+	size_t busy = 0; // Number of jobs currently running.
+	bool stopping = false;
+};
@@ -1,5 +1,8 @@
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <array>
+#include <algorithm>
 #include <condition_variable>
 #include <string>
 #include <random>
@@ -7,6 +10,14 @@
 #include <easy/profiler.h> // Used on Windows builds.
 
 #include "digitsOfPi.h" // Fabrice Bellard's implementation of the Bailey-Borwein-Plouffe formula allowing to compute an arbitrary digit of PI.
+#include "reorderBuffer.h" // Puts digits computed in parallel back into order.
+#include "spscRing.h" // Lock-free channel between one producer and one consumer.
+#include "mpmcQueue.h" // Lock-free channel between any number of producers and consumers.
+#include "digitsOfPiChudnovsky.h" // Every digit up to some position at once, for when the whole range is wanted.
+#include "digitsOfPiSpigot.h" // Digits one after the other, each continuing from the last.
+#include "digitsOfPiHex.h" // Hexadecimal digits, much cheaper to extract than decimal ones.
+#include "digitsOfPiGourdon.h" // A faster kernel than Bellard's past the first thousand digits.
+#include "digitCache.h" // Digits already computed, shared by every producer.
 
 constexpr const size_t FIRST_DIGIT = 0; // Firist digit of PI to print.
 constexpr const size_t LAST_DIGIT = 6; // Last digit of PI to print.
@@ -16,6 +27,7 @@ struct PieceOfPi
 {
 	size_t producerId = 0; // Index of the producer thread that has generated the digit.
 	size_t consumerId = 0; // Index of the consumer thread that has consumed the digit.
+	size_t position = 0; // Index of the digit of PI this piece holds.
 	char digit = 0; // The digit to consume.
 
 	// Use to get a string description of the PieceOfPi.
@@ -23,6 +35,7 @@ struct PieceOfPi
 	{
 		std::string str = "{ digit: ";
 		str += digit;
+		str += "; position: " + std::to_string(position);
 		str += "; producerId: " + std::to_string(producerId);
 		str += "; consumerId: " + std::to_string(consumerId);
 		str += " }";
@@ -39,6 +52,31 @@ void MessWithCompiler()
 	std::this_thread::sleep_for(std::chrono::milliseconds(d(e)));
 }
 
+// GetNthPiDigitFastest through SharedPiDigitCache: a position any producer has computed lately is only looked up.
+int CachedNthPiDigit(const size_t position)
+{
+	return SharedPiDigitCache().GetOrCompute((int)position, [](const int pos) { return GetNthPiDigitFastest(pos); });
+}
+
+// Where SingleThreaded_Producer and CV_Producer take their digits from.
+enum class DigitSource
+{
+	Bbp, // CachedNthPiDigit: any position on its own, but every digit not cached starts over.
+	Spigot, // PiSpigot: only cheap in order, but then each digit continues from the previous one.
+	Hex, // GetNthPiHexDigit: digits in base 16 rather than 10, for consumers that can take them. O(n log n) per position instead of O(n^2).
+};
+
+DigitSource digitSource = DigitSource::Bbp; // Which source the producers below use.
+PiSpigot spigot; // State the Spigot source continues from. Only one producer at a time uses it: SingleThreaded ones run in turn, CV ones hold m.
+
+// The digit of PI at position, as a character, from digitSource.
+char ProduceDigit(const size_t position)
+{
+	if (digitSource == DigitSource::Spigot) return (char)('0' + spigot.DigitAt(position));
+	if (digitSource == DigitSource::Hex) return GetNthPiHexCharacter((int)position);
+	return std::to_string(CachedNthPiDigit(position))[0];
+}
+
 PieceOfPi buffer = {}; // Structure the functions will use to pass around digits of PI. Used both by producers and consumers. This resource needs to be protected.
 std::string toPrint = ""; // Where consumers will write the result of the producer. This resource needs to be protected.
 size_t iteration = FIRST_DIGIT; // The index of the next digit of PI to compute. This resource needs to be protected.
@@ -47,7 +85,8 @@ void SingleThreaded_Producer(const size_t id)
 {
 	EASY_FUNCTION(profiler::colors::Yellow);
 
-	buffer.digit = std::to_string(GetNthPiDigit(iteration))[0];
+	buffer.digit = ProduceDigit(iteration);
+	buffer.position = iteration;
 	buffer.producerId = id;
 	iteration++;
 }
@@ -66,7 +105,8 @@ void NoMutex_Producer(const size_t id)
 {
 	EASY_FUNCTION(profiler::colors::Blue);
 
-	buffer.digit = std::to_string(GetNthPiDigit(iteration))[0];
+	buffer.digit = std::to_string(CachedNthPiDigit(iteration))[0];
+	buffer.position = iteration;
 	buffer.producerId = id;
 
 	MessWithCompiler(); // This forces a data race.
@@ -90,7 +130,8 @@ void MutexOnly_Producer(const size_t id)
 
 	EASY_FUNCTION(profiler::colors::Green);
 
-	buffer.digit = std::to_string(GetNthPiDigit(iteration))[0];
+	buffer.digit = std::to_string(CachedNthPiDigit(iteration))[0];
+	buffer.position = iteration;
 	buffer.producerId = id;
 
 	iteration++;
@@ -121,7 +162,8 @@ void CV_Producer(const size_t id)
 	EASY_FUNCTION(profiler::colors::Red);
 	MessWithCompiler(); // Everything still works despite this.
 
-	buffer.digit = std::to_string(GetNthPiDigit(iteration))[0];
+	buffer.digit = ProduceDigit(iteration);
+	buffer.position = iteration;
 	MessWithCompiler(); // Everything still works despite this.
 	buffer.producerId = id;
 	MessWithCompiler(); // Everything still works despite this.
@@ -152,4 +194,175 @@ void CV_Consumer(const size_t id)
 	MessWithCompiler(); // Everything still works despite this.
 	cv_producer.notify_one();
 	MessWithCompiler(); // Everything still works despite this.
-}
\ No newline at end of file
+}
+
+std::atomic<size_t> ticket = FIRST_DIGIT; // The index of the next digit of PI a Ticket_Producer will claim. Atomic so that claiming a digit doesn't require locking m.
+ReorderBuffer<PieceOfPi> reorderBuffer; // Ticket producers finish their digits in any order, this hands them over to the consumers in the order of their positions.
+
+// Hands a finished piece over to a Ticket_Consumer through buffer. Only ever called by one thread at a time by reorderBuffer, in order of positions.
+void Ticket_Publish(const PieceOfPi& piece)
+{
+	std::unique_lock<std::mutex> lck(m); // Only publishing the finished piece is a critical section.
+	cv_producer.wait(lck, []{return !produced;});
+
+	buffer = piece;
+
+	produced = true;
+	cv_consumer.notify_one();
+}
+
+void Ticket_Producer(const size_t id)
+{
+	EASY_FUNCTION(profiler::colors::Orange);
+
+	PieceOfPi piece;
+	piece.position = ticket.fetch_add(1); // Claim the next position without locking anything.
+	piece.digit = std::to_string(CachedNthPiDigit(piece.position))[0]; // The expensive part: done without holding m, so other producers can compute their own digits in parallel.
+	piece.producerId = id;
+
+	reorderBuffer.Push(piece.position, piece, Ticket_Publish); // Publishes this piece and any that were waiting on it, unless an earlier position is still being computed.
+}
+
+void Ticket_Consumer(const size_t id)
+{
+	std::unique_lock<std::mutex> lck(m);
+	cv_consumer.wait(lck, []{return produced;});
+
+	EASY_FUNCTION(profiler::colors::Orange100);
+
+	buffer.consumerId = id;
+	toPrint += "Consumer has recieved the buffer: " + buffer.ToString() + "\n";
+
+	produced = false;
+	cv_producer.notify_one();
+}
+
+SpscRing<PieceOfPi, 64> spscRing; // Channel between the one Spsc_Producer and the one Spsc_Consumer. Lets the producer run up to 64 digits ahead without waking anyone up.
+
+void Spsc_Producer(const size_t id)
+{
+	EASY_FUNCTION(profiler::colors::Purple);
+
+	for (size_t position = FIRST_DIGIT; position <= LAST_DIGIT; position++)
+	{
+		PieceOfPi piece;
+		piece.position = position;
+		piece.digit = std::to_string(CachedNthPiDigit(position))[0];
+		piece.producerId = id;
+
+		spscRing.Push(piece);
+	}
+}
+
+void Spsc_Consumer(const size_t id)
+{
+	EASY_FUNCTION(profiler::colors::Purple100);
+
+	for (size_t position = FIRST_DIGIT; position <= LAST_DIGIT; position++)
+	{
+		PieceOfPi piece = spscRing.Pop();
+		piece.consumerId = id;
+		toPrint += "Consumer has recieved the buffer: " + piece.ToString() + "\n";
+	}
+}
+
+MpmcQueue<PieceOfPi, 64> mpmcQueue; // Channel shared by all the Mpmc producers and consumers, replaces buffer, m, cv_producer and cv_consumer.
+std::array<PieceOfPi, LAST_DIGIT - FIRST_DIGIT + 1> consumed = {}; // Where Mpmc consumers put the pieces they've received. Each consumer writes to the slot of its piece's position, so no two write to the same element.
+
+void Mpmc_Producer(const size_t id)
+{
+	EASY_FUNCTION(profiler::colors::Teal);
+
+	PieceOfPi piece;
+	piece.position = ticket.fetch_add(1);
+	piece.digit = std::to_string(CachedNthPiDigit(piece.position))[0];
+	piece.producerId = id;
+
+	mpmcQueue.Push(piece);
+}
+
+void Mpmc_Consumer(const size_t id)
+{
+	EASY_FUNCTION(profiler::colors::Teal100);
+
+	PieceOfPi piece = mpmcQueue.Pop();
+	piece.consumerId = id;
+	consumed[piece.position - FIRST_DIGIT] = piece;
+}
+
+// Puts the pieces the Mpmc consumers have received into toPrint, in order of position. Call once all of them are done.
+void PrintConsumed()
+{
+	for (const auto& piece : consumed)
+	{
+		toPrint += "Consumer has recieved the buffer: " + piece.ToString() + "\n";
+	}
+}
+
+// Job for a WorkStealingExecutor: id is the worker running it. Pieces go through reorderBuffer, then through spscRing to a Spsc_Consumer.
+void WorkStealing_Producer(const size_t id, const size_t position)
+{
+	EASY_FUNCTION(profiler::colors::Brown);
+
+	PieceOfPi piece;
+	piece.position = position;
+	piece.digit = std::to_string(CachedNthPiDigit(position))[0];
+	piece.producerId = id;
+
+	reorderBuffer.Push(piece.position, piece, [](const PieceOfPi& ready){ spscRing.Push(ready); }); // Only one worker at a time releases from reorderBuffer, so spscRing still only has one producer at a time.
+}
+
+constexpr const size_t BLOCKS_PER_JOB = 4; // Blocks of digits a Block_Producer computes in one batch. A batch costs about as much as its last block alone.
+
+// Job for a WorkStealingExecutor: covers the BLOCKS_PER_JOB * PI_BLOCK_DIGITS positions from position on, with one GetPiDigitBlocks call.
+// A block that couldn't vouch for all of its digits leaves a gap before the next one, which the job fills with GetPiDigitBlock calls.
+// Doesn't go through SharedPiDigitCache: it holds GetNthPiDigit's 9 digits per position, not blocks, and no other producer runs alongside this one to fill it.
+void Block_Producer(const size_t id, const size_t position)
+{
+	EASY_FUNCTION(profiler::colors::Cyan);
+
+	const size_t end = std::min(position + BLOCKS_PER_JOB * PI_BLOCK_DIGITS, LAST_DIGIT + 1);
+	const size_t blockCount = (end - position + PI_BLOCK_DIGITS - 1) / PI_BLOCK_DIGITS;
+	std::array<PiDigitBlock, BLOCKS_PER_JOB> blocks;
+	GetPiDigitBlocks((int)position, (int)blockCount, blocks.data());
+
+	size_t next = position;
+	for (size_t i = 0; i < blockCount; i++)
+	{
+		const size_t blockEnd = std::min(position + (i + 1) * PI_BLOCK_DIGITS, end);
+		PiDigitBlock block = blocks[i];
+		while (true)
+		{
+			for (int digit = 0; digit < block.count && next < blockEnd; digit++, next++)
+			{
+				PieceOfPi piece;
+				piece.position = next;
+				piece.digit = block.digits[digit];
+				piece.producerId = id;
+
+				reorderBuffer.Push(piece.position, piece, [](const PieceOfPi& ready){ spscRing.Push(ready); });
+			}
+			if (next == blockEnd) break;
+			block = GetPiDigitBlock((int)next);
+		}
+	}
+}
+
+// Computes every digit from FIRST_DIGIT to LAST_DIGIT with one GetPiDigitsChudnovsky call, spread across KernelPool, instead of one GetNthPiDigit call each.
+// Then hands them to a Spsc_Consumer through spscRing, like Spsc_Producer.
+// Doesn't go through SharedPiDigitCache: one call computes the whole range at a fraction of the cost of the positions on their own, so there's nothing for a lookup to save.
+void Chudnovsky_Producer(const size_t id)
+{
+	EASY_FUNCTION(profiler::colors::Pink);
+
+	const std::string digits = GetPiDigitsChudnovsky(LAST_DIGIT + 1);
+	for (size_t position = FIRST_DIGIT; position <= LAST_DIGIT; position++)
+	{
+		PieceOfPi piece;
+		piece.position = position;
+		piece.digit = digits[position];
+		piece.producerId = id;
+
+		spscRing.Push(piece);
+	}
+}
@@ -1,4 +1,5 @@
 #include <vector>
+#include <algorithm>
 #include <numeric>
 #include <iostream>
 #include <random>
@@ -13,8 +14,12 @@
 #include "exercise.h"
 #endif//!USE_WORKING_IMPLEMENTATION
 
+#include "workerPool.h"
+#include "workStealing.h"
+#include "digitCost.h"
+
 // Used to make the order of kicking of producers and consumers unpredictable.
-std::vector<std::thread> threads;
+std::vector<std::thread> threads; // Only used by strategies that need dedicated threads.
 std::vector<size_t> iterations(LAST_DIGIT - FIRST_DIGIT + 1);
 
 // Resets all variables to default.
@@ -28,12 +33,21 @@ void Reset()
 	toPrint.clear();
 	toPrint.resize(1024); // 1024 is arbitrary, just to ensure there's no heap allocations.
 	produced = false;
+#if USE_WORKING_IMPLEMENTATION
+	ticket = FIRST_DIGIT;
+	reorderBuffer.Reset(FIRST_DIGIT);
+	consumed = {};
+	SharedPiDigitCache().Clear(); // Otherwise only the first strategy would compute digits, and the profiles of the others would only show lookups.
+#endif//!USE_WORKING_IMPLEMENTATION
 }
 
 int main()
 {
 	EASY_PROFILER_ENABLE;
 
+	WorkerPool pool; // Runs the producers and consumers of all the threaded strategies, so they don't pay for creating two threads per digit.
+	WorkStealingExecutor stealers; // Runs the producers of the WorkStealing strategy.
+
 	std::cout << "Value of a float PI: " << std::to_string(3.141592f) << std::endl;
 
 	Reset();
@@ -49,9 +63,47 @@ int main()
 	std::cout << "Using NoMutex functions to generate digits of PI..." << std::endl;
 	for (const auto& index : iterations)
 	{
-		threads.push_back(std::thread(NoMutex_Producer, index));
-		threads.push_back(std::thread(NoMutex_Consumer, index));
+		pool.Submit(NoMutex_Producer, index);
+		pool.Submit(NoMutex_Consumer, index);
+	}
+	pool.Wait();
+	std::cout << toPrint << std::endl;
+
+	Reset();
+	std::cout << "Using MutexOnly functions to generate digits of PI..." << std::endl;
+	for (const auto& index : iterations)
+	{
+		pool.Submit(MutexOnly_Producer, index);
+		pool.Submit(MutexOnly_Consumer, index);
+	}
+	pool.Wait();
+	std::cout << toPrint << std::endl;
+
+	Reset();
+	std::cout << "Using CV functions to generate digits of PI..." << std::endl;
+	for (const auto& index : iterations)
+	{
+		pool.Submit(CV_Producer, index);
+		pool.Submit(CV_Consumer, index);
+	}
+	pool.Wait();
+	std::cout << toPrint << std::endl;
+
+#if USE_WORKING_IMPLEMENTATION
+	Reset();
+	std::cout << "Using Ticket functions to generate digits of PI..." << std::endl;
+	for (const auto& index : iterations)
+	{
+		pool.Submit(Ticket_Producer, index);
+		pool.Submit(Ticket_Consumer, index);
 	}
+	pool.Wait();
+	std::cout << toPrint << std::endl;
+
+	Reset();
+	std::cout << "Using Spsc functions to generate digits of PI..." << std::endl;
+	threads.emplace_back(std::thread(Spsc_Producer, 0)); // A single producer and a single consumer pass every digit through the ring. They get their own threads since both loop until all digits went through.
+	threads.emplace_back(std::thread(Spsc_Consumer, 0));
 	for (auto& thread : threads)
 	{
 		thread.join();
@@ -59,12 +111,21 @@ int main()
 	std::cout << toPrint << std::endl;
 
 	Reset();
-	std::cout << "Using MutexOnly functions to generate digits of PI..." << std::endl;
+	std::cout << "Using Mpmc functions to generate digits of PI..." << std::endl;
 	for (const auto& index : iterations)
 	{
-		threads.push_back(std::thread(MutexOnly_Producer, index));
-		threads.push_back(std::thread(MutexOnly_Consumer, index));
+		pool.Submit(Mpmc_Producer, index);
+		pool.Submit(Mpmc_Consumer, index);
 	}
+	pool.Wait();
+	PrintConsumed();
+	std::cout << toPrint << std::endl;
+
+	Reset();
+	std::cout << "Using WorkStealing functions to generate digits of PI..." << std::endl;
+	SortLongestJobFirst(iterations); // Shuffled order is the worst case for balancing the load: start the most expensive digits first instead.
+	threads.emplace_back(std::thread(Spsc_Consumer, 0)); // Receives the digits in order from whichever worker releases them from the reorder buffer.
+	stealers.Run(iterations, WorkStealing_Producer);
 	for (auto& thread : threads)
 	{
 		thread.join();
@@ -72,18 +133,63 @@ int main()
 	std::cout << toPrint << std::endl;
 
 	Reset();
-	std::cout << "Using CV functions to generate digits of PI..." << std::endl;
-	for (const auto& index : iterations)
+	std::cout << "Using Block functions to generate digits of PI..." << std::endl;
+	std::vector<size_t> blocks; // First position of every batch of blocks of digits a Block_Producer computes at once.
+	for (size_t position = FIRST_DIGIT; position <= LAST_DIGIT; position += BLOCKS_PER_JOB * PI_BLOCK_DIGITS)
+	{
+		blocks.push_back(position);
+	}
+	SortLongestJobFirst(blocks);
+	threads.emplace_back(std::thread(Spsc_Consumer, 0));
+	stealers.Run(blocks, Block_Producer);
+	for (auto& thread : threads)
 	{
-		threads.emplace_back(std::thread(CV_Producer, index));
-		threads.emplace_back(std::thread(CV_Consumer, index));
+		thread.join();
 	}
+	std::cout << toPrint << std::endl;
+
+	Reset();
+	std::cout << "Using Chudnovsky functions to generate digits of PI..." << std::endl;
+	threads.emplace_back(std::thread(Chudnovsky_Producer, 0)); // Computes the whole range in one go, then streams it through the ring to the consumer.
+	threads.emplace_back(std::thread(Spsc_Consumer, 0));
 	for (auto& thread : threads)
 	{
 		thread.join();
 	}
 	std::cout << toPrint << std::endl;
 
+	digitSource = DigitSource::Spigot; // The SingleThreaded and CV producers ask for their digits in order, which is all a spigot needs.
+	Reset();
+	std::cout << "Using SingleThreaded functions with the Spigot digit source to generate digits of PI..." << std::endl;
+	for (size_t i = FIRST_DIGIT; i <= LAST_DIGIT; i++)
+	{
+		SingleThreaded_Producer(i);
+		SingleThreaded_Consumer(i);
+	}
+	std::cout << toPrint << std::endl;
+
+	Reset();
+	std::cout << "Using CV functions with the Spigot digit source to generate digits of PI..." << std::endl;
+	for (const auto& index : iterations)
+	{
+		pool.Submit(CV_Producer, index);
+		pool.Submit(CV_Consumer, index);
+	}
+	pool.Wait();
+	std::cout << toPrint << std::endl;
+
+	digitSource = DigitSource::Hex;
+	Reset();
+	std::cout << "Using SingleThreaded functions with the Hex digit source to generate hexadecimal digits of PI..." << std::endl;
+	for (size_t i = FIRST_DIGIT; i <= LAST_DIGIT; i++)
+	{
+		SingleThreaded_Producer(i);
+		SingleThreaded_Consumer(i);
+	}
+	std::cout << toPrint << std::endl;
+	digitSource = DigitSource::Bbp;
+#endif//!USE_WORKING_IMPLEMENTATION
+
 	const auto nrOfBlocksWritten = profiler::dumpBlocksToFile("profilerOutputs/session.prof");
 #ifdef BUILD_WITH_EASY_PROFILER
 	assert(nrOfBlocksWritten && "Easy profiler has failed to write profiling data to disk!");
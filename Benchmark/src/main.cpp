@@ -0,0 +1,299 @@
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <numeric>
+
+#include "digitsOfPi.h"
+#include "digitsOfPiParallel.h"
+#include "digitsOfPiWide.h"
+#include "digitsOfPiChudnovsky.h"
+#include "digitsOfPiSpigot.h"
+#include "digitsOfPiHex.h"
+#include "digitsOfPiGourdon.h"
+#include "digitCache.h"
+
+// Best wall clock time of a few runs of f, in milliseconds. The best rather than the average since anything else running only ever adds time.
+double TimeMs(const std::function<void()>& f, const int runs = 3)
+{
+	double best = 1e300;
+	for (int i = 0; i < runs; i++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		f();
+		const auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	return best;
+}
+
+// Times the modular multiplications GetNthPiDigit can use for odd primes against each other.
+void BenchmarkModularMultiplication(const std::vector<int>& positions)
+{
+	std::cout << "GetNthPiDigit, modular multiplication for odd primes (ms):" << std::endl;
+	std::cout << std::setw(10) << "position" << std::setw(12) << "division" << std::setw(12) << "montgomery" << std::setw(12) << "barrett" << std::endl;
+	for (const int pos : positions)
+	{
+		int division = 0, montgomery = 0, barrett = 0;
+		const double divisionMs = TimeMs([&]{ division = GetNthPiDigitWith<DivisionModulus>(pos, SimdLevel::None); });
+		const double montgomeryMs = TimeMs([&]{ montgomery = GetNthPiDigitWith<MontgomeryModulus>(pos, SimdLevel::None); });
+		const double barrettMs = TimeMs([&]{ barrett = GetNthPiDigitWith<BarrettModulus>(pos, SimdLevel::None); });
+		if (montgomery != division || barrett != division) throw std::runtime_error("Modular multiplications disagree at position " + std::to_string(pos) + ".");
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << std::setw(10) << pos << std::setw(12) << divisionMs << std::setw(12) << montgomeryMs << std::setw(12) << barrettMs << std::endl;
+	}
+}
+
+// Times the vector kernels the CPU supports against the scalar one.
+void BenchmarkSimd(const std::vector<int>& positions)
+{
+	const SimdLevel best = DetectSimdLevel();
+	std::cout << "GetNthPiDigit, vector kernels (ms):" << std::endl;
+	std::cout << std::setw(10) << "position" << std::setw(12) << "scalar" << std::setw(12) << "avx2" << std::setw(12) << "avx512" << std::endl;
+	for (const int pos : positions)
+	{
+		std::cout << std::setw(10) << pos;
+		const int expected = GetNthPiDigitWith<MontgomeryModulus>(pos, SimdLevel::None);
+		for (const SimdLevel level : { SimdLevel::None, SimdLevel::Avx2, SimdLevel::Avx512 })
+		{
+			if (level > best)
+			{
+				std::cout << std::setw(12) << "n/a";
+				continue;
+			}
+			int result = 0;
+			const double ms = TimeMs([&]{ result = GetNthPiDigitWith<MontgomeryModulus>(pos, level); });
+			if (result != expected) throw std::runtime_error("Vector kernel disagrees with the scalar one at position " + std::to_string(pos) + ".");
+			std::cout << std::fixed << std::setprecision(1) << std::setw(12) << ms;
+		}
+		std::cout << std::endl;
+	}
+}
+
+// Times splitting the primes of one digit across KernelPool against computing them all on the calling thread.
+void BenchmarkIntraDigitParallelism(const std::vector<int>& positions)
+{
+	std::cout << "GetNthPiDigit vs GetNthPiDigitParallel on " << KernelPool().Size() << " workers + the caller (ms):" << std::endl;
+	std::cout << std::setw(10) << "position" << std::setw(12) << "serial" << std::setw(12) << "parallel" << std::endl;
+	for (const int pos : positions)
+	{
+		int serial = 0, parallel = 0;
+		const double serialMs = TimeMs([&]{ serial = GetNthPiDigit(pos); });
+		const double parallelMs = TimeMs([&]{ parallel = GetNthPiDigitParallel(pos); });
+		if (serial != parallel) throw std::runtime_error("GetNthPiDigitParallel disagrees with GetNthPiDigit at position " + std::to_string(pos) + ".");
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << std::setw(10) << pos << std::setw(12) << serialMs << std::setw(12) << parallelMs << std::endl;
+	}
+}
+
+// Pairs (x, m) of an odd modulus m from bits - 1 to bits bits and a residue coprime with it, like the den and av the kernels invert.
+template<typename Word>
+std::vector<std::pair<Word, Word>> InversePairs(const int bits, const size_t count)
+{
+	std::mt19937_64 random(bits);
+	std::vector<std::pair<Word, Word>> pairs;
+	while (pairs.size() < count)
+	{
+		const Word m = (Word)(((uint64_t)1 << (bits - 1)) | random() >> (65 - bits) | 1);
+		const Word x = (Word)(1 + random() % (m - 1));
+		if (std::gcd(x, m) == 1) pairs.emplace_back(x, m);
+	}
+	return pairs;
+}
+
+// Times inv_mod_binary against Bellard's inv_mod and inv_mod2, and its 64-bit version against InvModFull, over the sizes of moduli the kernels invert:
+// up to 3N, which is about 2.7 times the position.
+void BenchmarkModularInverse()
+{
+	const size_t count = 1000000;
+	std::cout << "Modular inverses, " << count << " of them (ms):" << std::endl;
+	std::cout << std::setw(10) << "bits" << std::setw(12) << "inv_mod" << std::setw(12) << "inv_mod2" << std::setw(12) << "binary" << std::endl;
+	for (const int bits : { 12, 18, 24, 30 })
+	{
+		const auto pairs = InversePairs<uint32_t>(bits, count);
+		std::vector<uint32_t> euclid(count), original(count), binary(count);
+		const double euclidMs = TimeMs([&]{ for (size_t i = 0; i < count; i++) euclid[i] = (uint32_t)inv_mod((int)pairs[i].first, (int)pairs[i].second); });
+		const double originalMs = TimeMs([&]{ for (size_t i = 0; i < count; i++) original[i] = (uint32_t)inv_mod2((int)pairs[i].first, (int)pairs[i].second); });
+		const double binaryMs = TimeMs([&]{ for (size_t i = 0; i < count; i++) binary[i] = inv_mod_binary(pairs[i].first, pairs[i].second); });
+		if (euclid != binary || original != binary) throw std::runtime_error("Modular inverses disagree for " + std::to_string(bits) + "-bit moduli.");
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << std::setw(10) << bits << std::setw(12) << euclidMs << std::setw(12) << originalMs << std::setw(12) << binaryMs << std::endl;
+	}
+	for (const int bits : { 36, 48, 62 })
+	{
+		const auto pairs = InversePairs<uint64_t>(bits, count);
+		std::vector<uint64_t> euclid(count), binary(count);
+		const double euclidMs = TimeMs([&]{ for (size_t i = 0; i < count; i++) euclid[i] = InvModFull(pairs[i].first, pairs[i].second); });
+		const double binaryMs = TimeMs([&]{ for (size_t i = 0; i < count; i++) binary[i] = inv_mod_binary(pairs[i].first, pairs[i].second); });
+		if (euclid != binary) throw std::runtime_error("Modular inverses disagree for " + std::to_string(bits) + "-bit moduli.");
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << std::setw(10) << bits << std::setw(12) << euclidMs << std::setw(12) << "n/a" << std::setw(12) << binaryMs << std::endl;
+	}
+}
+
+// Times a modular inverse for every term of GetNthPiDigit's sum against a single one per prime.
+void BenchmarkInversion(const std::vector<int>& positions)
+{
+	std::cout << "GetNthPiDigit, inverses of den (ms):" << std::endl;
+	std::cout << std::setw(10) << "position" << std::setw(12) << "per term" << std::setw(12) << "once" << std::endl;
+	for (const int pos : positions)
+	{
+		int perTerm = 0, once = 0;
+		const double perTermMs = TimeMs([&]{ perTerm = GetNthPiDigitWith<MontgomeryModulus, Inversion::PerTerm>(pos, SimdLevel::None); });
+		const double onceMs = TimeMs([&]{ once = GetNthPiDigitWith<MontgomeryModulus, Inversion::Once>(pos, SimdLevel::None); });
+		if (perTerm != once) throw std::runtime_error("Inversions disagree at position " + std::to_string(pos) + ".");
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << std::setw(10) << pos << std::setw(12) << perTermMs << std::setw(12) << onceMs << std::endl;
+	}
+}
+
+// Times the kernel on 32-bit words against 64-bit ones, with GetNthPiDigit's scalar kernel for reference.
+void BenchmarkWordSize(const std::vector<int>& positions)
+{
+	std::cout << "GetNthPiDigitWide, word size (ms):" << std::endl;
+	std::cout << std::setw(10) << "position" << std::setw(12) << "int" << std::setw(12) << "32-bit" << std::setw(12) << "64-bit" << std::endl;
+	for (const int pos : positions)
+	{
+		uint64_t narrow = 0, wide = 0;
+		const double intMs = TimeMs([&]{ GetNthPiDigitWith<MontgomeryModulus>(pos, SimdLevel::None); });
+		const double narrowMs = TimeMs([&]{ narrow = WidePiFixedPointFraction<uint32_t>(pos); });
+		const double wideMs = TimeMs([&]{ wide = WidePiFixedPointFraction<uint64_t>(pos); });
+		if (narrow != wide || wide != PiFixedPointFractionWith<MontgomeryModulus>(pos, SimdLevel::None, 0)) throw std::runtime_error("Word sizes disagree at position " + std::to_string(pos) + ".");
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << std::setw(10) << pos << std::setw(12) << intMs << std::setw(12) << narrowMs << std::setw(12) << wideMs << std::endl;
+	}
+}
+
+// Times the first digits of PI one GetNthPiDigit call at a time against streaming them out of a PiSpigot, and against all at once with GetPiDigitsChudnovsky.
+void BenchmarkPrefix(const std::vector<int>& counts)
+{
+	std::cout << "First digits of PI, GetNthPiDigit per digit vs PiSpigot vs GetPiDigitsChudnovsky (ms):" << std::endl;
+	std::cout << std::setw(10) << "digits" << std::setw(12) << "per digit" << std::setw(12) << "spigot" << std::setw(12) << "chudnovsky" << std::endl;
+	for (const int count : counts)
+	{
+		std::string perDigit, spigot, chudnovsky;
+		const double perDigitMs = TimeMs([&]
+		{
+			perDigit.clear();
+			for (int pos = 0; pos < count; pos++)
+			{
+				perDigit += (char)('0' + (pos == 0 ? 3 : GetNthPiDigit(pos) / 100000000)); // The first of the 9 digits GetNthPiDigit gives from pos on, leading zero included.
+			}
+		}, 1); // Once: this is the slow one.
+		const double spigotMs = TimeMs([&]
+		{
+			spigot.clear();
+			PiSpigot digits;
+			for (int pos = 0; pos < count; pos++)
+			{
+				spigot += (char)('0' + digits.Next());
+			}
+		});
+		const double chudnovskyMs = TimeMs([&]{ chudnovsky = GetPiDigitsChudnovsky(count); });
+		if (spigot != perDigit) throw std::runtime_error("PiSpigot disagrees with GetNthPiDigit on the first " + std::to_string(count) + " digits.");
+		if (chudnovsky != perDigit) throw std::runtime_error("GetPiDigitsChudnovsky disagrees with GetNthPiDigit on the first " + std::to_string(count) + " digits.");
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << std::setw(10) << count << std::setw(12) << perDigitMs << std::setw(12) << spigotMs << std::setw(12) << chudnovskyMs << std::endl;
+	}
+}
+
+// Times a decimal position with GetNthPiDigit against a hexadecimal one with GetNthPiHexDigit.
+void BenchmarkHex(const std::vector<int>& positions)
+{
+	std::cout << "GetNthPiDigit vs GetNthPiHexDigit (ms):" << std::endl;
+	std::cout << std::setw(10) << "position" << std::setw(12) << "decimal" << std::setw(12) << "hex" << std::endl;
+	for (const int pos : positions)
+	{
+		int decimal = 0, hex = 0;
+		const double decimalMs = TimeMs([&]{ decimal = GetNthPiDigit(pos); });
+		const double hexMs = TimeMs([&]{ hex = GetNthPiHexDigit(pos); });
+		if (decimal == 0 || hex == 0) throw std::runtime_error("No digits at position " + std::to_string(pos) + "."); // Keeps both calls from being optimized away.
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << std::setw(10) << pos << std::setw(12) << decimalMs << std::setw(12) << hexMs << std::endl;
+	}
+	if (GetNthPiHexDigit(1000000) != 0x26C65E5) throw std::runtime_error("GetNthPiHexDigit is wrong at position 1000000."); // The published hexadecimal digits from the millionth on.
+}
+
+// Times GetNthPiDigit against GetNthPiDigitGourdon, both with the best vector kernels, around the position GetNthPiDigitFastest switches at.
+// Both are still O(n^2) give or take a log: a call at 10^6 takes about 100 times one at 10^5, minutes, so main only runs it when given GOURDON_MILLION_FLAG.
+// 10^7, at over half a day per call, is left out.
+void BenchmarkGourdon(const std::vector<int>& positions, const int runs = 3)
+{
+	// The kernels round their last digits differently, so each is checked on its leading 6 against the exact digits rather than against the other.
+	const std::string reference = GetPiDigitsChudnovsky((size_t)*std::max_element(positions.begin(), positions.end()) + 6);
+	const auto leadingDigits = [](const int digits)
+	{
+		std::string padded = std::to_string(digits);
+		padded.insert(0, 9 - padded.size(), '0'); // GetNthPiDigit's 9 digits, leading zeros included.
+		return padded.substr(0, 6);
+	};
+
+	std::cout << "GetNthPiDigit vs GetNthPiDigitGourdon (ms), switching at " << GOURDON_MIN_POSITION << ":" << std::endl;
+	std::cout << std::setw(10) << "position" << std::setw(12) << "bellard" << std::setw(12) << "gourdon" << std::endl;
+	for (const int pos : positions)
+	{
+		int bellard = 0, gourdon = 0;
+		const double bellardMs = TimeMs([&]{ bellard = GetNthPiDigit(pos); }, runs);
+		const double gourdonMs = TimeMs([&]{ gourdon = GetNthPiDigitGourdon(pos); }, runs);
+		if (leadingDigits(bellard) != reference.substr(pos, 6)) throw std::runtime_error("GetNthPiDigit is wrong at position " + std::to_string(pos) + ".");
+		if (leadingDigits(gourdon) != reference.substr(pos, 6)) throw std::runtime_error("GetNthPiDigitGourdon is wrong at position " + std::to_string(pos) + ".");
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << std::setw(10) << pos << std::setw(12) << bellardMs << std::setw(12) << gourdonMs << std::endl;
+	}
+}
+
+// Times overlapping ranges of positions through a PiDigitCache: the first pass computes every digit, the ones after only those it hasn't seen.
+void BenchmarkDigitCache(const int first, const int count, const int overlap)
+{
+	std::cout << "PiDigitCache, ranges of " << count << " positions from " << first << " overlapping by " << overlap << " (ms):" << std::endl;
+	std::cout << std::setw(10) << "range" << std::setw(12) << "uncached" << std::setw(12) << "cached" << std::endl;
+	PiDigitCache cache;
+	for (int range = 0; range < 3; range++)
+	{
+		const int start = first + range * (count - overlap);
+		std::vector<int> uncached(count), cached(count);
+		const double uncachedMs = TimeMs([&]{ for (int i = 0; i < count; i++) uncached[i] = GetNthPiDigitFastest(start + i); }, 1);
+		const double cachedMs = TimeMs([&]{ for (int i = 0; i < count; i++) cached[i] = cache.GetOrCompute(start + i, [](const int pos) { return GetNthPiDigitFastest(pos); }); }, 1);
+		if (cached != uncached) throw std::runtime_error("PiDigitCache disagrees with GetNthPiDigitFastest from position " + std::to_string(start) + ".");
+
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << std::setw(10) << range << std::setw(12) << uncachedMs << std::setw(12) << cachedMs << std::endl;
+	}
+}
+
+constexpr const char* GOURDON_MILLION_FLAG = "--gourdon-million"; // Runs BenchmarkGourdon at position 10^6, once per kernel, instead of the usual benchmarks.
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::string(argv[1]) == GOURDON_MILLION_FLAG)
+	{
+		BenchmarkGourdon({ 1000000 }, 1);
+		return 0;
+	}
+
+	BenchmarkModularMultiplication({ 500, 1000, 2000, 4000, 8000 });
+	BenchmarkSimd({ 1000, 4000, 16000 });
+	BenchmarkIntraDigitParallelism({ 4000, 16000, 32000 });
+	BenchmarkModularInverse();
+	BenchmarkInversion({ 1000, 4000, 8000 });
+	BenchmarkWordSize({ 1000, 4000, 8000 });
+	BenchmarkPrefix({ 100, 300, 1000 });
+	BenchmarkHex({ 1000, 4000, 16000 });
+	BenchmarkGourdon({ 300, 1000, 10000, 30000, 100000 });
+	BenchmarkDigitCache(2000, 200, 150);
+	return 0;
+}